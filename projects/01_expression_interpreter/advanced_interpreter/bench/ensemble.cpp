@@ -0,0 +1,170 @@
+#include "expression.hpp"
+#include "ensemble.hpp"
+#include "program.hpp"
+#include "analysis.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+// thousands of small formulas over one set of variables, one row each, as a rules engine sees them: the ensemble
+// against every expression evaluated on its own, walked as a tree and run as its own compiled Program
+namespace {
+
+constexpr std::array<std::string_view, 8> names = {"a", "b", "c", "d", "e", "f", "g", "h"};
+
+// terms drawn from a small alphabet, so the same subterms keep turning up in different formulas
+std::string formula(std::mt19937_64& rng, int depth) {
+	auto pick = [&](std::size_t n) { return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng); };
+	if (depth == 0 || pick(4) == 0) {
+		static constexpr std::array<std::string_view, 4> numbers = {"1", "2", "0.5", "3"};
+		return std::string(pick(3) ? names[pick(names.size())] : numbers[pick(numbers.size())]);
+	}
+	switch (pick(6)) {
+		case 0: return "sin(" + formula(rng, depth - 1) + ")";
+		case 1: return "sqrt(abs(" + formula(rng, depth - 1) + "))";
+		case 2: return formula(rng, depth - 1) + " > " + formula(rng, depth - 1) + " ? " + formula(rng, depth - 1)
+			+ " : " + formula(rng, depth - 1);
+		default: {
+			static constexpr std::array<std::string_view, 4> ops = {" + ", " - ", " * ", " / "};
+			return "(" + formula(rng, depth - 1) + std::string(ops[pick(ops.size())]) + formula(rng, depth - 1) + ")";
+		}
+	}
+}
+
+bool same(double a, double b) {
+	return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b) || (std::isnan(a) && std::isnan(b));
+}
+
+// best of five rounds, in ns per formula; every round moves the row a little so nothing can be carried over
+template <typename F>
+double nanoseconds(F eval, std::size_t formulas) {
+	volatile double sink = 0;
+	double best = INFINITY;
+	for (int round = 0; round < 5; ++round) {
+		auto start = std::chrono::steady_clock::now();
+		sink = sink + eval(round);
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / formulas);
+	}
+	return best;
+}
+
+double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+
+	std::mt19937_64 rng(47);
+	std::vector<Expression> expressions;
+	std::size_t nodes = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		expressions.emplace_back(formula(rng, 3));
+		nodes += expressions.back().analyze().nodes;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	Ensemble<double> ensemble(expressions);
+	auto merging = seconds(start);
+
+	start = std::chrono::steady_clock::now();
+	std::vector<Program<double>> programs;
+	for (auto& expression : expressions) {
+		programs.push_back(expression.compile<double>());
+	}
+	auto compiling = seconds(start);
+
+	// every program wants its own variables in its own order, gathered from the shared row
+	std::vector<std::vector<std::size_t>> gathers;
+	for (auto& program : programs) {
+		auto& gather = gathers.emplace_back();
+		for (auto& name : program.variables()) {
+			gather.push_back(std::ranges::find(names, name) - names.begin());
+		}
+	}
+	std::vector<std::size_t> order;
+	for (auto& name : ensemble.variables()) {
+		order.push_back(std::ranges::find(names, name) - names.begin());
+	}
+
+	std::array<double, names.size()> row;
+	auto fill = [&](int round) {
+		for (std::size_t i = 0; i < row.size(); ++i) {
+			row[i] = static_cast<double>(i) - 3.5 + round * 0.01;
+		}
+	};
+
+	std::vector<double> merged(ensemble.size()), separate(expressions.size());
+	std::vector<double> vars(order.size());
+	auto run_ensemble = [&](int round) {
+		fill(round);
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			vars[i] = row[order[i]];
+		}
+		ensemble.eval(vars, merged);
+		return merged.back();
+	};
+
+	Context<double> context(programs.front());
+	for (auto& program : programs) {
+		context.reserve(program);
+	}
+	std::vector<double> args;
+	auto run_programs = [&](int round) {
+		fill(round);
+		for (std::size_t p = 0; p < programs.size(); ++p) {
+			args.clear();
+			for (auto i : gathers[p]) {
+				args.push_back(row[i]);
+			}
+			separate[p] = programs[p].run(context, args);
+		}
+		return separate.back();
+	};
+
+	for (auto& expression : expressions) {
+		expression.tiering({Tiering::never});
+	}
+	Variables<double> map;
+	auto run_trees = [&](int round) {
+		fill(round);
+		for (std::size_t i = 0; i < names.size(); ++i) {
+			map[names[i]] = row[i];
+		}
+		for (std::size_t e = 0; e < expressions.size(); ++e) {
+			separate[e] = expressions[e].eval<double>(map, {});
+		}
+		return separate.back();
+	};
+
+	run_ensemble(0);
+	run_trees(0);
+	for (std::size_t e = 0; e < expressions.size(); ++e) {
+		if (!same(merged[e], separate[e])) {
+			std::printf("formula %zu disagrees: %s\n", e, expressions[e].to_string().c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::printf("%zu formulas, %zu nodes, %zu cells after sharing\n", count, nodes, ensemble.cells());
+	std::printf("merge %.1f ms, compile every Program %.1f ms\n", merging * 1e3, compiling * 1e3);
+	auto tree = nanoseconds(run_trees, count);
+	auto program = nanoseconds(run_programs, count);
+	auto merge = nanoseconds(run_ensemble, count);
+	std::printf("%-24s %10s %10s\n", "ns per formula, one row", "ns", "speedup");
+	std::printf("%-24s %10.1f %10.2f\n", "tree walk", tree, 1.);
+	std::printf("%-24s %10.1f %10.2f\n", "one Program each", program, tree / program);
+	std::printf("%-24s %10.1f %10.2f\n", "ensemble", merge, tree / merge);
+}
@@ -0,0 +1,90 @@
+#include "fastmath.hpp"
+
+#include <string_view>
+#include <vector>
+#include <array>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// accuracy of every tier against long double libm, in ulps of the double result, and time per call against libm;
+// the fast tier falls back to libm where it has no kernel, shown as -
+namespace {
+
+struct Case {
+	std::string_view name;
+	double (*exact)(double);
+	double (*fast)(double);
+	double (*approx)(double);
+	long double (*reference)(long double);
+	double lo, hi;
+};
+
+double ulps(double value, long double reference) {
+	auto target = static_cast<double>(reference);
+	if (std::isinf(target)) {
+		return value == target ? 0. : INFINITY;
+	}
+	auto ulp = std::nextafter(std::abs(target), INFINITY) - std::abs(target);
+	return static_cast<double>(std::abs(static_cast<long double>(value) - reference) / ulp);
+}
+
+double relative(double value, long double reference) {
+	return reference == 0 ? std::abs(value) : static_cast<double>(std::abs((value - reference) / reference));
+}
+
+template <typename F>
+double nanoseconds(F f, const std::vector<double>& inputs) {
+	volatile double sink = 0;
+	double best = INFINITY;
+	for (int round = 0; round < 5; ++round) {
+		auto start = std::chrono::steady_clock::now();
+		double sum = 0;
+		for (double x : inputs) {
+			sum += f(x);
+		}
+		sink = sink + sum;
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / inputs.size());
+	}
+	return best;
+}
+
+}
+
+int main() {
+	const std::array<Case, 5> cases = {{
+		{"exp", [](double x) { return std::exp(x); }, exp_fast, exp_approx, [](long double x) { return std::exp(x); }, -700., 700.},
+		{"log", [](double x) { return std::log(x); }, nullptr, log_approx, [](long double x) { return std::log(x); }, 1e-300, 1e300},
+		{"sin", [](double x) { return std::sin(x); }, nullptr, sin_approx, [](long double x) { return std::sin(x); }, -1e4, 1e4},
+		{"cos", [](double x) { return std::cos(x); }, nullptr, cos_approx, [](long double x) { return std::cos(x); }, -1e4, 1e4},
+		{"tan", [](double x) { return std::tan(x); }, nullptr, tan_approx, [](long double x) { return std::tan(x); }, -1e4, 1e4},
+	}};
+
+	std::mt19937_64 rng(29);
+	std::printf("%-5s %12s %12s %14s %10s %10s %10s\n", "", "exact ulp", "fast ulp", "approx rel", "exact ns", "fast ns", "approx ns");
+	for (auto& c : cases) {
+		// log spans magnitudes, the rest are uniform over their range
+		std::vector<double> inputs(1 << 21);
+		std::uniform_real_distribution<double> uniform(c.lo, c.hi), exponent(std::log(c.lo), std::log(c.hi));
+		for (auto& x : inputs) {
+			x = c.name == "log" ? std::exp(exponent(rng)) : uniform(rng);
+		}
+
+		auto fast_call = c.fast ? c.fast : c.exact;
+		double exact = 0, fast = 0, approx = 0;
+		for (double x : inputs) {
+			auto reference = c.reference(x);
+			exact = std::max(exact, ulps(c.exact(x), reference));
+			fast = std::max(fast, ulps(fast_call(x), reference));
+			approx = std::max(approx, relative(c.approx(x), reference));
+		}
+		std::printf("%-5s %12.3f %12.3f %14.2e %10.2f ", c.name.data(), exact, fast, approx, nanoseconds(c.exact, inputs));
+		if (c.fast) {
+			std::printf("%10.2f", nanoseconds(c.fast, inputs));
+		} else {
+			std::printf("%10s", "-");
+		}
+		std::printf(" %10.2f\n", nanoseconds(c.approx, inputs));
+	}
+}
@@ -0,0 +1,67 @@
+#include "expression.hpp"
+#include "analysis.hpp"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+#include <malloc.h>
+
+// heap held by many expressions derived from one large base: copies, substitutions and specializations share every
+// subtree they leave unchanged, against the same expressions parsed from their own text, which share nothing, as
+// every copy and rewrite did before nodes became immutable
+namespace {
+
+std::size_t live() {
+	auto info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+}
+
+// heap bytes per expression while all of them are alive
+double footprint(std::size_t count, const std::function<Expression(std::size_t)>& make) {
+	std::vector<Expression> held;
+	held.reserve(count);
+	auto before = live();
+	for (std::size_t i = 0; i < count; ++i) {
+		held.push_back(make(i));
+	}
+	return static_cast<double>(live() - before) / static_cast<double>(count);
+}
+
+}
+
+int main(int argc, char** argv) {
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+
+	// a hundred terms that never change, and one that reads z
+	std::string terms;
+	for (int i = 1; i <= 100; ++i) {
+		auto k = std::to_string(i);
+		terms += "sin(x * " + k + ") * exp(-y / " + k + ") + ";
+	}
+	auto text = [&](const std::string& z) { return terms + "x * " + z; };
+
+	Expression base(text("z"));
+	std::printf("base: %zu nodes, %zu expressions of each kind\n", base.analyze().nodes, count);
+	auto number = [](std::size_t i) { return std::to_string(i + 1); };
+
+	std::printf("%-14s %16s %16s %8s\n", "", "shared B/expr", "parsed B/expr", "ratio");
+	// a copy allocates nothing at all, which leaves no ratio to print
+	auto report = [&](const char* name, double shared, double parsed) {
+		std::printf("%-14s %16.0f %16.0f ", name, shared, parsed);
+		if (shared > 0) {
+			std::printf("%8.1f\n", parsed / shared);
+		} else {
+			std::printf("%8s\n", "-");
+		}
+	};
+	auto parsed = footprint(count, [&](std::size_t) { return Expression(text("z")); });
+	report("copy", footprint(count, [&](std::size_t) { return base; }), parsed);
+
+	parsed = footprint(count, [&](std::size_t i) { return Expression(text(number(i))); });
+	report("substitute", footprint(count, [&](std::size_t i) { return base.substitute("z", Expression(number(i))); }), parsed);
+	report("specialize", footprint(count, [&](std::size_t i) { return base.specialize({{"z", static_cast<double>(i + 1)}}); }), parsed);
+}
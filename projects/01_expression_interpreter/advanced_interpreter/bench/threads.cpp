@@ -0,0 +1,179 @@
+#include "expression.hpp"
+#include "library.hpp"
+#include "program.hpp"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <latch>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+// stress: many threads run the same shared Programs at once, scalar and batch, each with one Context reserved for all
+// of them, and every result must match a single-threaded run bit for bit. scaling: one shared Program from 1 to N threads
+namespace {
+
+const std::vector<std::string> formulas = {
+	"sin(x) * exp(-y / 4) + x^3 - 2*x*y",
+	"let r = sqrt(x * x + y * y) in r > 1 ? exp(-r) : pow(r, 3) / 2",
+	"x > 0 && y > 0 ? log(x) + log(y) : -(x + y)",
+	"wave(x, y) - wave(y, x) * hyp(x, 2)",
+};
+
+bool same(double a, double b) {
+	return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b) || (std::isnan(a) && std::isnan(b));
+}
+
+struct Compiled {
+	Program<double> program;
+	std::size_t x, y;
+	std::vector<double> expected;
+};
+
+// every thread walks the rows in its own order, so the same Program is at different points on every thread
+std::size_t stress(const std::vector<Compiled>& compiled, const std::vector<double>& xs, const std::vector<double>& ys,
+	std::size_t threads, std::size_t rounds) {
+
+	std::atomic<std::size_t> mismatches{0};
+	std::latch start(static_cast<std::ptrdiff_t>(threads));
+	std::vector<std::thread> workers;
+	for (std::size_t t = 0; t < threads; ++t) {
+		workers.emplace_back([&, t] {
+			Context<double> context(compiled.front().program);
+			for (auto& c : compiled) {
+				context.reserve(c.program);
+			}
+			std::vector<std::size_t> order(xs.size());
+			for (std::size_t i = 0; i < order.size(); ++i) {
+				order[i] = i;
+			}
+			std::mt19937_64 rng(t);
+			std::vector<double> out(xs.size());
+			std::vector<std::uint8_t> faults(xs.size());
+			start.arrive_and_wait();
+
+			std::size_t wrong = 0;
+			for (std::size_t round = 0; round < rounds; ++round) {
+				std::ranges::shuffle(order, rng);
+				for (auto& c : compiled) {
+					double row[2];
+					for (auto i : order) {
+						row[c.x] = xs[i];
+						row[c.y] = ys[i];
+						wrong += !same(c.program.run(context, row), c.expected[i]);
+					}
+					if (!c.program.run(context, {{"x", xs}, {"y", ys}}, out, faults)) {
+						++wrong;
+						continue;
+					}
+					for (std::size_t i = 0; i < out.size(); ++i) {
+						wrong += !same(out[i], c.expected[i]);
+					}
+				}
+			}
+			mismatches += wrong;
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	return mismatches;
+}
+
+// wall time for every thread to run its own copy of the same work on the shared Program
+double seconds(const Compiled& c, const std::vector<double>& xs, const std::vector<double>& ys, std::size_t threads,
+	std::size_t reps) {
+
+	std::vector<double> sums(threads);
+	std::latch start(static_cast<std::ptrdiff_t>(threads) + 1);
+	std::vector<std::thread> workers;
+	for (std::size_t t = 0; t < threads; ++t) {
+		workers.emplace_back([&, t] {
+			Context<double> context(c.program);
+			double row[2], sum = 0;
+			start.arrive_and_wait();
+			for (std::size_t rep = 0; rep < reps; ++rep) {
+				for (std::size_t i = 0; i < xs.size(); ++i) {
+					row[c.x] = xs[i];
+					row[c.y] = ys[i];
+					sum += c.program.run(context, row);
+				}
+			}
+			sums[t] = sum;
+		});
+	}
+	auto begin = std::chrono::steady_clock::now();
+	start.arrive_and_wait();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	volatile double sink = 0;
+	for (double sum : sums) {
+		sink = sink + sum;
+	}
+	return elapsed;
+}
+
+}
+
+int main(int argc, char** argv) {
+	std::size_t limit = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(4u, std::thread::hardware_concurrency());
+
+	// nothing is inlined, so the definitions run as subroutines with frames of their own
+	Library library(0);
+	library.define("hyp(a, b) = sqrt(a^2 + b^2)");
+	library.define("wave(a, b) = sin(a) * cos(b) + hyp(a, b)");
+
+	std::mt19937_64 rng(34);
+	std::uniform_real_distribution<double> uniform(-3., 3.);
+	std::vector<double> xs(4096), ys(4096);
+	for (std::size_t i = 0; i < xs.size(); ++i) {
+		xs[i] = uniform(rng);
+		ys[i] = uniform(rng);
+	}
+
+	std::vector<Compiled> compiled;
+	for (auto& formula : formulas) {
+		auto program = Expression(formula, library).compile<double>();
+		auto x = program.index("x"), y = program.index("y");
+		Context<double> context(program);
+		std::vector<double> expected(xs.size());
+		for (std::size_t i = 0; i < xs.size(); ++i) {
+			double row[2];
+			row[x] = xs[i];
+			row[y] = ys[i];
+			expected[i] = program.run(context, row);
+		}
+		compiled.push_back({std::move(program), x, y, std::move(expected)});
+	}
+
+	auto threads = std::max<std::size_t>(2 * limit, 8);
+	auto mismatches = stress(compiled, xs, ys, threads, 16);
+	std::printf("stress: %zu threads, %zu formulas x %zu rows x 16 rounds, scalar and batch: %zu mismatches\n",
+		threads, compiled.size(), xs.size(), mismatches);
+	if (mismatches) {
+		return EXIT_FAILURE;
+	}
+
+	// the same work per thread, so perfect scaling keeps the wall time flat
+	auto& heaviest = compiled.back();
+	const std::size_t reps = 64;
+	std::printf("%8s %12s %12s %10s\n", "threads", "seconds", "Mevals/s", "speedup");
+	double base = 0;
+	for (std::size_t n = 1; n <= limit; ++n) {
+		auto elapsed = seconds(heaviest, xs, ys, n, reps);
+		auto rate = static_cast<double>(n * reps * xs.size()) / elapsed / 1e6;
+		if (n == 1) {
+			base = rate;
+		}
+		std::printf("%8zu %12.3f %12.2f %10.2f\n", n, elapsed, rate, rate / base);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "visitor.hpp"
+#include "program.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <functional>
+#include <limits>
+
+// static cost of one evaluation, known before anything runs
+struct Analysis {
+	// nodes as the Counter sees them; depth is the longest path from the root to a leaf, groups included
+	std::size_t nodes = 0, depth = 0;
+	// binary and logical operators by symbol, unary ones prefixed with u, "?:" and "let" for the rest, calls by name
+	std::map<std::string, std::size_t, std::less<>> operators;
+	// rough cycles for real exact arithmetic, taking the dearer side of every conditional
+	double cycles = 0.;
+	// slots a compiled Program needs: operand stack, let and parameter locals, user call arguments, the variable row
+	// and the return addresses of nested subroutines
+	std::size_t stack = 0, locals = 0, arguments = 0, variables = 0, calls = 0;
+
+	template <typename T>
+	std::size_t scratch() const noexcept {
+		return (stack + locals + arguments + variables) * sizeof(T) + variables * sizeof(const T*) + calls * sizeof(Return);
+	}
+};
+
+// checked once an expression is built, before it can be evaluated; the parser enforces depth as it goes
+struct Limits {
+	std::size_t nodes = std::numeric_limits<std::size_t>::max();
+	std::size_t depth = std::numeric_limits<std::size_t>::max();
+	double cycles = std::numeric_limits<double>::infinity();
+	// bytes of a Context<double>
+	std::size_t scratch = std::numeric_limits<std::size_t>::max();
+
+	bool bounded() const noexcept;
+	void admit(const Analysis&) const;
+};
+
+class Analyzer : public Visitor {
+public:
+	Analysis analyze(const class ASTNode&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	Analysis analysis;
+	std::vector<std::string_view> names;
+
+	// mirror the Compiler's bookkeeping, so stack and locals come out as the Program would size them
+	std::size_t level = 0, height = 0, scope = 0, base = 0, calls = 0;
+
+	void count(std::string_view, double);
+	void push() noexcept;
+	void descend(const class ASTNode&);
+};
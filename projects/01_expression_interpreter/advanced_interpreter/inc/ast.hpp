@@ -1,58 +1,112 @@
 #pragma once
 
+#include "metrics.hpp"
+
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 
 struct ASTNode {
+	ASTNode() noexcept {
+		Metrics::count(Metric::nodes);
+		Metrics::count(Metric::allocations);
+	}
 	virtual ~ASTNode() noexcept = default;
-	virtual void accept(class Visitor&) = 0;
+	virtual void accept(class Visitor&) const = 0;
 };
 
+// nodes are immutable once built, so any number of trees can share a subtree and copying a tree copies one pointer
+using Node = std::shared_ptr<const ASTNode>;
+
 struct BinaryNode : ASTNode {
 	std::string op;
-	std::unique_ptr<ASTNode> left, right;
+	Node left, right;
 
-	BinaryNode(std::string_view op, std::unique_ptr<ASTNode> left, std::unique_ptr<ASTNode> right)
+	BinaryNode(std::string_view op, Node left, Node right)
 		: op(op), left(std::move(left)), right(std::move(right)) {}
-	void accept(class Visitor&) override;
+	void accept(class Visitor&) const override;
 };
 
 struct UnaryNode : ASTNode {
 	std::string op;
-	std::unique_ptr<ASTNode> base;
+	Node base;
 
-	UnaryNode(std::string_view op, std::unique_ptr<ASTNode> base)
+	UnaryNode(std::string_view op, Node base)
 		: op(op), base(std::move(base)) {}
-	void accept(class Visitor&) override;
+	void accept(class Visitor&) const override;
+};
+
+struct LogicalNode : ASTNode {
+	std::string op;
+	Node left, right;
+
+	LogicalNode(std::string_view op, Node left, Node right)
+		: op(op), left(std::move(left)), right(std::move(right)) {}
+	void accept(class Visitor&) const override;
+};
+
+struct CondNode : ASTNode {
+	Node cond, on_true, on_false;
+
+	CondNode(Node cond, Node on_true, Node on_false)
+		: cond(std::move(cond)), on_true(std::move(on_true)), on_false(std::move(on_false)) {}
+	void accept(class Visitor&) const override;
+};
+
+struct Binding {
+	std::string id;
+	std::size_t slot;
+	Node value;
+
+	Binding(std::string_view id, std::size_t slot, Node value)
+		: id(id), slot(slot), value(std::move(value)) {}
+};
+
+struct LetNode : ASTNode {
+	std::vector<Binding> bindings;
+	Node body;
+
+	LetNode(std::vector<Binding>&& bindings, Node body)
+		: bindings(std::move(bindings)), body(std::move(body)) {}
+	void accept(class Visitor&) const override;
 };
 
 struct GroupNode : ASTNode {
-	std::unique_ptr<ASTNode> base;
+	Node base;
 
-	GroupNode(std::unique_ptr<ASTNode> base) : base(std::move(base)) {}
-	void accept(class Visitor&) override;
+	GroupNode(Node base) : base(std::move(base)) {}
+	void accept(class Visitor&) const override;
+};
+
+struct Definition {
+	std::string id;
+	std::vector<std::string> params;
+	Node body;
 };
 
 struct FuncNode : ASTNode {
 	std::string id;
-	std::vector<std::unique_ptr<ASTNode>> args;
+	std::vector<Node> args;
+	std::shared_ptr<const Definition> definition;
 
-	FuncNode(std::string_view id, std::vector<std::unique_ptr<ASTNode>>&& args)
-		: id(id), args(std::move(args)) {}
-	void accept(class Visitor&) override;
+	FuncNode(std::string_view id, std::vector<Node>&& args, std::shared_ptr<const Definition> definition = nullptr)
+		: id(id), args(std::move(args)), definition(std::move(definition)) {}
+	void accept(class Visitor&) const override;
 };
 
 struct VarNode : ASTNode {
 	std::string id;
+	std::optional<std::size_t> slot;
 
-	VarNode(std::string_view id) : id(id) {}
-	void accept(class Visitor&) override;
+	VarNode(std::string_view id, std::optional<std::size_t> slot = std::nullopt) : id(id), slot(slot) {}
+	void accept(class Visitor&) const override;
 };
 
 struct NumNode : ASTNode {
 	double value;
 
 	NumNode(std::string_view value) : value(std::stod(std::string(value))) {}
-	void accept(class Visitor&) override;
+	NumNode(double value) : value(value) {}
+	void accept(class Visitor&) const override;
 };
\ No newline at end of file
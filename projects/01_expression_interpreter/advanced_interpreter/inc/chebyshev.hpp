@@ -0,0 +1,32 @@
+#pragma once
+
+#include "expression.hpp"
+#include "interval.hpp"
+#include "visitor.hpp"
+
+#include <string_view>
+#include <vector>
+
+// piecewise Chebyshev interpolant of one variable on uniform pieces; error() is the largest absolute
+// deviation from the expression at 4 * order + 1 evenly spaced samples per piece, so the tolerance is met
+// on those samples, not guaranteed between them
+class Chebyshev {
+public:
+	Chebyshev(const Expression&, std::string_view, Interval, double,
+		const Variables<double>& = {}, const Functions<double>& = {}, std::size_t = 12);
+
+	double operator()(double) const noexcept;
+
+	Interval domain() const noexcept { return {lo, hi}; }
+	double error() const noexcept { return max_error; }
+	std::size_t pieces() const noexcept { return coeffs.size() / order; }
+	std::size_t degree() const noexcept { return order - 1; }
+	std::size_t memory() const noexcept { return sizeof(*this) + coeffs.capacity() * sizeof(double); }
+private:
+	double lo, hi, scale;
+	std::size_t order;
+	std::vector<double> coeffs;
+	double max_error = 0.;
+
+	double clenshaw(const double*, double) const noexcept;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "server.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <cstdint>
+
+struct Compiled {
+	std::uint64_t handle;
+	std::vector<std::string> variables;
+};
+
+// blocking client for one connection; server-side errors are rethrown as std::runtime_error
+class Client {
+public:
+	explicit Client(const std::string& path);
+	~Client();
+
+	Client(const Client&) = delete;
+	Client& operator=(const Client&) = delete;
+
+	Compiled compile(std::string_view);
+	// rows are row-major in the order of Compiled::variables; out and faults get one entry per row
+	void evaluate(const Compiled&, std::span<const double>, std::span<double>, std::span<std::uint8_t>);
+	ServerStats stats();
+private:
+	int socket = -1;
+
+	std::string call(std::uint8_t, std::string_view);
+};
+
+struct LoadReport {
+	std::size_t requests = 0;
+	std::size_t rows = 0;
+	double seconds = 0.;
+	double p50 = 0., p99 = 0.;
+	ServerStats server;
+
+	double throughput() const noexcept { return seconds > 0. ? static_cast<double>(requests) / seconds : 0.; }
+};
+
+// closed loop: every connection sends its next evaluate request as soon as the previous reply arrives
+LoadReport load(const std::string& path, const std::vector<std::string>& expressions,
+	std::size_t connections = 8, std::size_t requests = 2000, std::size_t rows = 16);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "visitor.hpp"
+#include "registry.hpp"
+#include "fastmath.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <cstdint>
+
+class Expression;
+
+enum class Gate : std::uint8_t {
+	add, sub, mul, div, neg, binary, native, call, both, either, select
+};
+
+// one SSA step: writes the next register from registers a, b, c; native and call read operands[a, a + b)
+struct Cell {
+	Gate gate;
+	std::uint32_t arg = 0, a = 0, b = 0, c = 0;
+
+	bool operator==(const Cell&) const noexcept = default;
+};
+
+template <typename T>
+class Merger;
+
+// many expressions merged into one instruction stream over a shared variable set: every variable is loaded once and
+// every subterm that appears in several expressions, or several times in one, is computed once;
+// conditionals and logical operators evaluate both sides and select, as SIMD lanes would, so user functions must be pure
+template <typename T>
+class Ensemble {
+public:
+	explicit Ensemble(std::span<const Expression>, const Functions<T>& = {});
+
+	// vars in the order of variables(); out gets one value per expression, in the order they were given
+	void eval(std::span<const T>, std::span<T>) const;
+	void eval(const Variables<T>&, std::span<T>) const;
+
+	std::size_t size() const noexcept { return outputs.size(); }
+	// distinct computed subterms after sharing
+	std::size_t cells() const noexcept { return code.size(); }
+	const std::vector<std::string>& variables() const noexcept { return names; }
+private:
+	std::vector<Cell> code;
+	std::vector<T> constants;
+	std::vector<std::string> names;
+	std::vector<std::uint32_t> operands;
+	std::vector<std::uint32_t> outputs;
+	std::vector<T (*)(T, T)> binaries;
+	std::vector<Native<T>> natives;
+	std::vector<Function<T>> functions;
+
+	friend class Merger<T>;
+};
+
+// registers are laid out as [variables][constants][cells]: the first two are numbered once the merge is complete
+template <typename T>
+class Merger : public Visitor {
+public:
+	Merger(Ensemble<T>& ensemble, const Functions<T>& funcs) noexcept : ensemble(ensemble), funcs(funcs) {}
+
+	void merge(const Expression&);
+	void finish();
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	struct Hash {
+		std::size_t operator()(const Cell&) const noexcept;
+	};
+
+	Ensemble<T>& ensemble;
+	const Functions<T>& funcs;
+	Accuracy accuracy = Accuracy::exact;
+
+	// until finish, registers carry their kind in the top bits, since variables and constants keep turning up
+	static constexpr std::uint32_t variable = 1u << 31, number = 1u << 30;
+
+	std::uint32_t result = 0;
+	std::vector<std::uint32_t> locals;
+	std::size_t base = 0;
+
+	std::unordered_map<Cell, std::uint32_t, Hash> cells;
+	std::unordered_map<std::string, std::uint32_t> variables;
+	std::unordered_map<std::uint64_t, std::uint32_t> constants;
+	std::unordered_map<std::string_view, std::uint32_t> calls;
+
+	std::uint32_t emit(Cell);
+	std::uint32_t constant(double);
+	std::uint32_t relocate(std::uint32_t) const noexcept;
+};
@@ -1,21 +1,127 @@
 #pragma once
 
 #include "ast.hpp"
+#include "visitor.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include "interval.hpp"
+#include "fastmath.hpp"
+#include "library.hpp"
+#include "generator.hpp"
+#include "program.hpp"
+#include "reduction.hpp"
+#include "tier.hpp"
+#include "analysis.hpp"
 
 #include <string>
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <ranges>
+#include <tuple>
+#include <utility>
+#include <stdexcept>
+#include <expected>
 
+// const members are reentrant: every call evaluates with its own evaluator; compile a Program for hot concurrent use
+// the tree is immutable and shared, so copies are one pointer and transformations allocate only the paths they change
+// parse and bind report structural errors as values; a bound Program never throws on the batch path
 class Expression {
 public:
-	Expression(const std::string&);
+	Expression(const std::string&, Accuracy = Accuracy::exact);
+	// input beyond the limits is rejected here: depth while parsing, the rest once the tree is inlined and optimized
+	Expression(const std::string&, const Library&, Accuracy = Accuracy::exact, const Limits& = {});
+
+	static std::expected<Expression, std::string> parse(const std::string&, Accuracy = Accuracy::exact) noexcept;
+	static std::expected<Expression, std::string> parse(const std::string&, const Library&, Accuracy = Accuracy::exact, const Limits& = {}) noexcept;
 
 	void print() const noexcept;
 	std::string to_string() const noexcept;
-	double eval(const std::unordered_map<std::string_view, double>&,
-				const std::unordered_map<std::string_view, std::function<double(const std::vector<double>&)>>&) const;
+	Analysis analyze() const;
+	// walks the tree until the expression turns out to be hot, then runs a compiled Program; copies share the tiers
+	template <typename T>
+	T eval(const Variables<T>&, const Functions<T>&) const;
+	template <typename T>
+	void eval(const Columns<T>&, const Functions<T>&, std::span<T>) const;
+	// the generator holds its own share of the tree, so it may outlive this expression; names and lvalue rows may not
+	template <typename T, std::ranges::viewable_range R>
+	Generator<T> stream(std::vector<std::string_view> names, R&& rows, Functions<T> funcs = {}) const {
+		return generate<T>(root, accuracy, std::move(names), std::views::all(std::forward<R>(rows)), std::move(funcs));
+	}
+	template <typename T>
+	Program<T> compile(const Functions<T>& = {}) const;
+	template <typename T>
+	std::expected<Program<T>, std::string> bind(const Functions<T>& = {}) const;
+	// row-major out[r * columns + c]; subtrees free of the column variable are computed once per row
+	template <typename T>
+	void grid(std::string_view, std::span<const T>, std::string_view, std::span<const T>, std::span<T>,
+		const Variables<T>& = {}, const Functions<T>& = {}, std::size_t threads = 1) const;
+	template <typename T>
+	Summary<T> reduce(const Columns<T>&, const Functions<T>& = {}, std::size_t threads = 1) const;
+	Histogram histogram(const Columns<double>&, double, double, std::size_t, const Functions<double>& = {}, std::size_t threads = 1) const;
+	// gives this copy fresh tiers under the new policy
+	void tiering(const Tiering&);
+	template <typename T>
+	TierStats tier_stats() const noexcept;
+	Expression specialize(const Variables<double>&) const;
+	// both share every subtree they leave unchanged with this expression, and with the replacement
+	Expression substitute(std::string_view, const Expression&) const;
+	Interval bound(const Box&) const;
+	CullResult cull(const Box&, Interval, std::size_t) const;
+#ifdef PROFILING
+	double profile(const Variables<double>&, const Functions<double>&, Profile&) const;
+#endif
 private:
-	std::string input;
-	std::unique_ptr<ASTNode> root;
-};
\ No newline at end of file
+	Node root;
+	Accuracy accuracy;
+	std::shared_ptr<Tiers> tiers;
+
+	template <typename>
+	friend class Merger;
+
+	Expression(Node, Accuracy);
+
+	template <typename T, typename R, typename F>
+	R fuse(const Columns<T>&, const Functions<T>&, std::size_t, const R&, F) const;
+
+	template <typename T, std::ranges::input_range V>
+	static Generator<T> generate(Node, Accuracy, std::vector<std::string_view>, V, Functions<T>);
+};
+
+template <typename T, std::ranges::input_range V>
+Generator<T> Expression::generate(Node root, Accuracy accuracy, std::vector<std::string_view> names, V rows, Functions<T> funcs) {
+
+	if (std::tuple_size_v<std::ranges::range_value_t<V>> != names.size()) {
+		throw std::runtime_error("Row size does not match variable names");
+	}
+
+	constexpr auto block = BatchEvaluator<T>::block;
+	std::vector<std::vector<T>> columns(names.size(), std::vector<T>(block));
+	std::vector<T> out(block);
+
+	Columns<T> vars;
+	for (std::size_t i = 0; i < names.size(); ++i) {
+		vars[names[i]] = columns[i];
+	}
+	BatchEvaluator<T> evaluator(vars, funcs, accuracy);
+
+	auto it = std::ranges::begin(rows);
+	auto end = std::ranges::end(rows);
+	while (it != end) {
+		std::size_t size = 0;
+		for (; size < block && it != end; ++it, ++size) {
+			std::apply([&](const auto&... values) {
+				std::size_t i = 0;
+				((columns[i++][size] = static_cast<T>(values)), ...);
+			}, *it);
+		}
+
+		evaluator.evaluate(*root, std::span(out).first(size));
+		for (std::size_t i = 0; i < size; ++i) {
+			co_yield out[i];
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+// exact: libm; fast: within 1 ulp, and libm wherever no kernel here beats it (only exp does);
+// approximate: relative error below 1e-6. `make bench` measures all three. The kernels work in double, so
+// only double evaluation uses them; float and complex keep libm, whose float routines are already faster
+enum class Accuracy {
+	exact, fast, approximate
+};
+
+double exp_fast(double) noexcept;
+
+double exp_approx(double) noexcept;
+double log_approx(double) noexcept;
+double sin_approx(double) noexcept;
+double cos_approx(double) noexcept;
+double tan_approx(double) noexcept;
+double pow_approx(double, double) noexcept;
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <version>
+
+#if __has_include(<generator>) && defined(__cpp_lib_generator)
+
+#include <generator>
+
+template <typename T>
+using Generator = std::generator<T>;
+
+#else
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <ranges>
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+template <typename T>
+class Generator : public std::ranges::view_base {
+public:
+	struct promise_type {
+		const T* value = nullptr;
+		std::exception_ptr exception;
+
+		Generator get_return_object() noexcept {
+			return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		std::suspend_always final_suspend() const noexcept { return {}; }
+		std::suspend_always yield_value(const T& yielded) noexcept {
+			value = std::addressof(yielded);
+			return {};
+		}
+		void return_void() const noexcept {}
+		void unhandled_exception() noexcept { exception = std::current_exception(); }
+		void await_transform() = delete;
+	};
+
+	class iterator {
+	public:
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() noexcept = default;
+		explicit iterator(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+
+		const T& operator*() const noexcept { return *handle.promise().value; }
+		iterator& operator++() {
+			resume(handle);
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+		bool operator==(std::default_sentinel_t) const noexcept { return !handle || handle.done(); }
+	private:
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	Generator() noexcept = default;
+	Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+	Generator& operator=(Generator&& other) noexcept {
+		std::swap(handle, other.handle);
+		return *this;
+	}
+	~Generator() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	// a default-constructed or moved-from generator is empty
+	iterator begin() {
+		if (handle) {
+			resume(handle);
+		}
+		return iterator(handle);
+	}
+	std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	explicit Generator(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+
+	static void resume(std::coroutine_handle<promise_type> handle) {
+		handle.resume();
+		if (auto exception = std::exchange(handle.promise().exception, nullptr)) {
+			std::rethrow_exception(exception);
+		}
+	}
+};
+
+#endif
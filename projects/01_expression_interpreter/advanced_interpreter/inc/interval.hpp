@@ -0,0 +1,61 @@
+#pragma once
+
+#include "visitor.hpp"
+
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <limits>
+
+struct Interval {
+	double lo, hi;
+
+	static Interval point(double value) noexcept { return {value, value}; }
+	static Interval entire() noexcept {
+		return {-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+	}
+	static Interval none() noexcept {
+		return {std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()};
+	}
+
+	bool empty() const noexcept { return !(lo <= hi); }
+	bool contains(double value) const noexcept { return lo <= value && value <= hi; }
+	bool intersects(Interval other) const noexcept { return !empty() && !other.empty() && lo <= other.hi && other.lo <= hi; }
+	double width() const noexcept { return hi - lo; }
+	double mid() const noexcept { return lo + (hi - lo) / 2; }
+};
+
+using Box = std::unordered_map<std::string_view, Interval>;
+
+struct CullResult {
+	std::vector<Box> regions;
+	std::size_t bounded = 0;
+	std::size_t culled = 0;
+	double culled_fraction = 0.;
+};
+
+class IntervalEvaluator : public Visitor {
+public:
+	IntervalEvaluator(const Box& vars) noexcept : vars(vars) {}
+
+	Interval evaluate(const class ASTNode&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	Interval result = Interval::none();
+	std::vector<Interval> locals;
+	std::vector<Interval> stack;
+	std::size_t base = 0;
+
+	const Box& vars;
+};
+
+CullResult cull(const class ASTNode&, const Box&, Interval, std::size_t);
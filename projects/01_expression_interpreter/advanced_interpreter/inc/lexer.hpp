@@ -1,25 +1,30 @@
 #pragma once
 
 #include "token.hpp"
+#include "metrics.hpp"
 
 #include <string_view>
-#include <vector>
-#include <unordered_map>
+#include <chrono>
 
 class Lexer {
 public:
-	Lexer(std::string_view input) noexcept : input(input) {}
-	std::vector<Token> tokenize();
+	Lexer(std::string_view input) : input(input), lookahead(extract()) {}
+	const Token& peek() const noexcept { return lookahead; }
+	Token next();
+	// time spent scanning, kept apart so the parser can report lexing and parsing separately
+	std::chrono::nanoseconds elapsed() const noexcept { return spent; }
 private:
 	std::string_view input;
 	std::size_t index = 0;
+	Token lookahead;
+	std::chrono::nanoseconds spent{0};
 
 	Token extract();
 	Token extract_id();
 	Token extract_num();
 	Token extract_op();
 
-	char peek(std::size_t = 0) const noexcept;
-	void advance(std::size_t = 1) noexcept;
+	char at(std::size_t = 0) const noexcept;
+	void skip(std::size_t = 1) noexcept;
 	[[noreturn]] void report(std::string_view) const;
-};
\ No newline at end of file
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "ast.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+
+// definitions may only call functions defined before them, so recursion cannot be expressed
+class Library {
+public:
+	Library(std::size_t limit = 32) noexcept : limit(limit) {}
+
+	void define(const std::string&);
+	std::shared_ptr<const Definition> find(std::string_view) const noexcept;
+	bool inlinable(const Definition&) const;
+private:
+	std::size_t limit;
+	std::unordered_map<std::string, std::shared_ptr<const Definition>> definitions;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "visitor.hpp"
+
+#include <vector>
+#include <memory>
+
+struct CacheStats {
+	std::size_t hits = 0;
+	std::size_t misses = 0;
+	std::size_t evictions = 0;
+
+	double hit_rate() const noexcept { return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.; }
+};
+
+// registers a pure function: results are cached by the exact bits of the arguments in a bounded LRU;
+// copies share one cache, so keep the Memoized itself to read stats after putting it in a Functions map
+template <typename T>
+class Memoized {
+public:
+	explicit Memoized(Function<T>, std::size_t capacity = 1024);
+
+	T operator()(const std::vector<T>&) const;
+
+	CacheStats stats() const;
+	void clear() const;
+private:
+	struct Cache;
+	std::shared_ptr<Cache> cache;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#ifdef METRICS
+#include <string>
+#include <vector>
+#include <array>
+#include <utility>
+#endif
+
+enum class Phase : std::uint8_t {
+	lex, parse, optimize, bind, eval
+};
+
+// allocations are the interpreter's own: tree nodes, compiled program contexts and evaluator scratch buffers
+enum class Metric : std::uint8_t {
+	expressions, nodes, allocations, promotions
+};
+
+#ifdef METRICS
+
+enum class MetricsFormat {
+	json, prometheus
+};
+
+// latencies in nanoseconds; buckets keep 3 significant bits, so every bound is within 12.5% of the true value
+struct PhaseStats {
+	std::uint64_t count = 0, total = 0, max = 0;
+	// (inclusive upper bound, hits) for non-empty buckets, ascending
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> buckets;
+
+	std::uint64_t percentile(double) const noexcept;
+};
+
+struct MetricsSnapshot {
+	std::array<PhaseStats, 5> phases;
+	std::array<std::uint64_t, 4> counters{};
+
+	const PhaseStats& phase(Phase phase) const noexcept { return phases[static_cast<std::size_t>(phase)]; }
+	std::uint64_t counter(Metric metric) const noexcept { return counters[static_cast<std::size_t>(metric)]; }
+
+	std::string to_json() const;
+	std::string to_prometheus() const;
+	void write(const std::string&, MetricsFormat) const;
+};
+
+// process-wide and lock-free: any thread may record while another takes a snapshot
+class Metrics {
+public:
+	static void record(Phase, std::chrono::nanoseconds) noexcept;
+	static void count(Metric, std::uint64_t = 1) noexcept;
+	static MetricsSnapshot snapshot();
+	static void reset() noexcept;
+};
+
+class Stopwatch {
+public:
+	Stopwatch() noexcept : start(std::chrono::steady_clock::now()) {}
+	std::chrono::nanoseconds elapsed() const noexcept { return std::chrono::steady_clock::now() - start; }
+private:
+	std::chrono::steady_clock::time_point start;
+};
+
+#else
+
+// compiled out: every call site folds away
+class Metrics {
+public:
+	static void record(Phase, std::chrono::nanoseconds) noexcept {}
+	static void count(Metric, std::uint64_t = 1) noexcept {}
+};
+
+class Stopwatch {
+public:
+	std::chrono::nanoseconds elapsed() const noexcept { return {}; }
+};
+
+#endif
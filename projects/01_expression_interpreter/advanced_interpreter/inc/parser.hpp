@@ -1,38 +1,57 @@
 #pragma once
 
 #include "token.hpp"
+#include "lexer.hpp"
+#include "metrics.hpp"
 #include "ast.hpp"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <limits>
 
 class Parser {
 
 public:
-	Parser(std::vector<Token>&& tokens) noexcept : tokens(std::move(tokens)) {}
-	std::unique_ptr<ASTNode> parse();
+	// limit bounds how deep the input may nest, so hostile input is rejected before it can exhaust the stack
+	Parser(Lexer lexer, std::size_t limit = std::numeric_limits<std::size_t>::max()) noexcept
+		: lexer(lexer), last(TokenType::END), limit(limit) {}
+	Node parse();
+	Definition parse_definition();
 private:
-	std::vector<Token> tokens;
-	std::size_t index = 0;
-
-	std::unique_ptr<ASTNode> parse_sum();
-	std::unique_ptr<ASTNode> parse_mul();
-	std::unique_ptr<ASTNode> parse_pow();
-	std::unique_ptr<ASTNode> parse_unary();
-	std::unique_ptr<ASTNode> parse_primary();
-	std::unique_ptr<ASTNode> parse_group();
-	std::unique_ptr<ASTNode> parse_func();
-
-	Token current() const noexcept;
-	Token previous() const noexcept;
-
-	void advance() noexcept;
+	Lexer lexer;
+	Token last;
+	std::vector<std::string_view> scope;
+	std::size_t limit, nesting = 0;
+
+	Node parse_expr();
+	Node parse_let();
+	Node parse_cond();
+	Node parse_or();
+	Node parse_and();
+	Node parse_equality();
+	Node parse_relational();
+	Node parse_sum();
+	Node parse_mul();
+	Node parse_pow();
+	Node parse_unary();
+	Node parse_primary();
+	Node parse_group();
+	Node parse_func();
+
+	const Token& current() const noexcept;
+	const Token& previous() const noexcept;
+
+	void advance();
+	void descend();
+	void lengthen(std::size_t&);
 	
 	template <typename... Args>
-	bool match(Args... args) noexcept;
+	bool match(Args... args);
 
 	void consume(TokenType, std::string_view);
+	void finish(const Stopwatch&);
 
 	[[noreturn]] void report(std::string_view) const;
 };
\ No newline at end of file
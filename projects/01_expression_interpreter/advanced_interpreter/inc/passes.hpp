@@ -0,0 +1,179 @@
+#pragma once
+
+#include "visitor.hpp"
+#include "ast.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <map>
+#include <utility>
+
+// rewrites by path copying: a visit that changes nothing leaves replacement empty, so the parent keeps its child,
+// and a rewrite allocates only the nodes between the root and what it changed; everything else stays shared
+class Rewriter : public Visitor {
+public:
+	void rewrite(Node&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+protected:
+	Node replacement;
+	// slots below depth are taken by enclosing lets or parameters
+	std::size_t depth = 0;
+
+	// a pure pass depends on nothing but the subtree and depth, so it remembers what it rewrote: a subtree with several
+	// parents is rewritten once and they keep sharing the result, where a plain walk would copy it once per parent
+	Rewriter(std::size_t depth = 0, bool pure = false) noexcept : depth(depth), pure(pure) {}
+
+	// rewrites the body of a linked definition in its own frame, above its parameters; every call site of the
+	// definition shares the one copy, and an unchanged body keeps the original
+	std::shared_ptr<const Definition> relink(const std::shared_ptr<const Definition>&);
+private:
+	bool pure;
+	std::map<std::pair<const ASTNode*, std::size_t>, Node> rewritten;
+	std::map<const Definition*, std::shared_ptr<const Definition>> relinked;
+};
+
+// moves local slots at or above threshold up by shift, so a tree can be placed under lets that already use them
+class Relocator : public Rewriter {
+public:
+	Relocator(std::size_t threshold, std::size_t shift) noexcept : Rewriter(0, true), threshold(threshold), shift(shift) {}
+
+	Node relocate(Node);
+
+	void visit(const class LetNode&) override;
+	void visit(const class VarNode&) override;
+private:
+	std::size_t threshold, shift;
+
+	std::size_t slot(std::size_t) const noexcept;
+};
+
+// replaces a free variable by a tree, relocated past the lets it lands under so that their slots stay apart
+class Substituter : public Rewriter {
+public:
+	Substituter(std::string_view id, const Node& value) noexcept : Rewriter(0, true), id(id), value(value) {}
+
+	void substitute(Node&);
+
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+private:
+	std::string_view id;
+	const Node& value;
+};
+
+class Counter : public Visitor {
+public:
+	std::size_t count(const class ASTNode&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	std::size_t nodes = 0;
+};
+
+class Inliner : public Rewriter {
+public:
+	Inliner(const class Library& library, std::size_t depth = 0) noexcept : Rewriter(depth), library(library) {}
+
+	void expand(Node&);
+
+	void visit(const class FuncNode&) override;
+private:
+	const class Library& library;
+};
+
+// Horner form, fma contraction, power chains and sqrt for ^0.5 all round differently from what was written, so they are
+// made only for expressions that asked for less than exact results; under exact the tree is left as it is
+class Optimizer : public Rewriter {
+public:
+	Optimizer(std::size_t depth = 0, Accuracy accuracy = Accuracy::exact) noexcept : Rewriter(depth), accuracy(accuracy) {}
+
+	void optimize(Node&);
+
+	void visit(const class BinaryNode&) override;
+private:
+	Accuracy accuracy;
+
+	Node power(Node, unsigned long);
+	Node horner(const class BinaryNode&, std::size_t&);
+};
+
+// folds with real arithmetic, so a specialized expression is meant for real evaluation
+class Specializer : public Rewriter {
+public:
+	Specializer(const Variables<double>& bindings, Accuracy accuracy = Accuracy::exact) noexcept
+		: bindings(bindings), accuracy(accuracy) {}
+
+	void specialize(Node&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+private:
+	std::unordered_map<std::size_t, double> known;
+
+	const Variables<double>& bindings;
+	Accuracy accuracy;
+
+	Node fold(const class ASTNode&) const;
+};
+
+struct Hoisted {
+	std::string id;
+	Node value;
+	bool per_row;
+};
+
+// replaces maximal subtrees that do not depend on the inner loop variable by variables named "$n",
+// so a grid computes them once per row, or once in total when they skip the outer variable too
+class Hoister : public Rewriter {
+public:
+	Hoister(std::string_view inner, std::string_view outer) noexcept : inner(inner), outer(outer) {}
+
+	std::vector<Hoisted> hoist(Node&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	unsigned mask = 0;
+	std::unordered_map<std::size_t, unsigned> slots;
+	std::unordered_map<const Definition*, unsigned> bodies;
+	std::vector<Hoisted> hoisted;
+
+	std::string_view inner, outer;
+
+	unsigned scan(Node&);
+	unsigned body(const Definition&);
+	void lift(Node&, unsigned);
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#ifdef PROFILING
+
+#include "visitor.hpp"
+#include "ast.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+
+struct ProfileEntry {
+	std::size_t hits = 0;
+	std::chrono::nanoseconds total{0};
+	std::chrono::nanoseconds self{0};
+};
+
+class Profile {
+public:
+	const ProfileEntry& node(const ASTNode&) const;
+	const std::map<std::string, ProfileEntry, std::less<>>& operators() const noexcept { return ops; }
+	const std::map<std::string, ProfileEntry, std::less<>>& functions() const noexcept { return funcs; }
+
+	std::string to_json() const;
+	std::string annotate() const;
+	void reset() noexcept;
+private:
+	friend class ProfilingEvaluator;
+
+	const ASTNode* root = nullptr;
+	std::vector<const ASTNode*> order;
+	std::unordered_map<const ASTNode*, ProfileEntry> nodes;
+	std::map<std::string, ProfileEntry, std::less<>> ops;
+	std::map<std::string, ProfileEntry, std::less<>> funcs;
+};
+
+class ProfilingEvaluator : public Evaluator {
+public:
+	ProfilingEvaluator(const Variables<double>& vars, const Functions<double>& funcs, Profile& profile,
+		Accuracy accuracy = Accuracy::exact)
+		: Evaluator(vars, funcs, accuracy), profile(profile) {}
+
+	double evaluate(const ASTNode&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	Profile& profile;
+	std::chrono::nanoseconds children{0};
+
+	template <typename Node>
+	void measure(Node&, std::map<std::string, ProfileEntry, std::less<>>*, std::string_view);
+};
+
+class ProfileStringifier : public Stringifier {
+public:
+	ProfileStringifier(const Profile& profile) noexcept : profile(profile) {}
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	const Profile& profile;
+
+	void annotate(const ASTNode&);
+};
+
+#endif
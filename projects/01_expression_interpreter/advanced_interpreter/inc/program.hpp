@@ -0,0 +1,147 @@
+#pragma once
+
+#include "visitor.hpp"
+#include "fastmath.hpp"
+#include "registry.hpp"
+#include "metrics.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <functional>
+#include <expected>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+
+enum class OpCode : std::uint8_t {
+	push, load_var, load_local, store_local,
+	add, sub, mul, div, neg, fma, binary, unary,
+	native, call, truth, jump, jump_if, jump_unless, invoke, ret
+};
+
+// per-row bits reported by a batch run instead of throwing
+enum class Fault : std::uint8_t {
+	none = 0,
+	domain = 1,
+	division = 2,
+	overflow = 4,
+	invalid = 8
+};
+
+struct Instruction {
+	OpCode op;
+	std::uint32_t arg = 0, count = 0;
+};
+
+// where ret resumes the caller: its next instruction and the base of its locals
+struct Return {
+	std::uint32_t pc, base;
+};
+
+struct Definition;
+
+template <typename T>
+class Context;
+
+template <typename T>
+class Compiler;
+
+// immutable once compiled: run may be called concurrently from any number of threads, one Context per thread
+template <typename T>
+class Program {
+public:
+	T run(Context<T>&, std::span<const T>) const;
+	std::expected<void, std::string> run(Context<T>&, const Columns<T>&, std::span<T>, std::span<std::uint8_t>) const;
+
+	const std::vector<std::string>& variables() const noexcept { return names; }
+	std::size_t index(std::string_view) const;
+private:
+	std::vector<Instruction> code;
+	std::vector<T> constants;
+	std::vector<std::string> names;
+	std::vector<T (*)(T, T)> binaries;
+	std::vector<T (*)(T)> unaries;
+	// calls are resolved once at bind: builtins to plain pointers, everything else to the user's functions
+	std::vector<Native<T>> natives;
+	std::vector<Function<T>> functions;
+	// calls is how deeply subroutines nest, which is finite since definitions cannot recurse
+	std::size_t depth = 0, frame = 0, arity = 0, calls = 0;
+
+	template <bool checked>
+	T execute(Context<T>&, const T*, std::uint8_t&) const;
+
+	friend class Context<T>;
+	friend class Compiler<T>;
+};
+
+template <typename T>
+class Context {
+public:
+	explicit Context(const Program<T>& program)
+		: stack(program.depth), locals(program.frame), row(program.names.size()), sources(program.names.size()), returns(program.calls) {
+		args.reserve(program.arity);
+		Metrics::count(Metric::allocations);
+	}
+
+	// grows to fit program, so one context can serve every program a thread runs
+	void reserve(const Program<T>& program) {
+		if (stack.size() < program.depth || locals.size() < program.frame || row.size() < program.names.size()
+			|| returns.size() < program.calls || args.capacity() < program.arity) {
+			Metrics::count(Metric::allocations);
+		}
+		stack.resize(std::max(stack.size(), program.depth));
+		locals.resize(std::max(locals.size(), program.frame));
+		row.resize(std::max(row.size(), program.names.size()));
+		sources.resize(std::max(sources.size(), program.names.size()));
+		returns.resize(std::max(returns.size(), program.calls));
+		args.reserve(program.arity);
+	}
+private:
+	std::vector<T> stack, locals, args, row;
+	std::vector<const T*> sources;
+	std::vector<Return> returns;
+
+	friend class Program<T>;
+};
+
+// definitions too large to inline are emitted once as subroutines: a call site invokes the body with a frame of locals
+// placed right above its own, and the frame is reused by every later call from the same depth
+template <typename T>
+class Compiler : public Visitor {
+public:
+	Compiler(const Functions<T>& funcs, Accuracy accuracy = Accuracy::exact)
+		: funcs(funcs), accuracy(accuracy) {}
+
+	std::expected<Program<T>, std::string> compile(const class ASTNode&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	struct Subroutine {
+		std::uint32_t entry;
+		// what the body needs above its call site
+		std::size_t depth, frame, calls;
+	};
+
+	Program<T> program;
+	std::size_t height = 0, depth = 0;
+	std::string error;
+	std::unordered_map<const Definition*, Subroutine> subroutines;
+
+	const Functions<T>& funcs;
+	Accuracy accuracy;
+
+	std::size_t emit(OpCode, std::size_t = 0, std::size_t = 0);
+	void patch(std::size_t) noexcept;
+	void store(std::size_t);
+	const Subroutine& subroutine(const Definition&);
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+
+// every frame is a u32 payload length, a u8 kind and the payload; integers and doubles travel in host byte order,
+// which is all a Unix domain socket can connect
+//
+// compile   request: expression text                   reply: u64 handle, u32 n, n x (u32 length, name)
+// evaluate  request: u64 handle, u32 rows, rows x n f64 reply: u32 rows, rows x f64, rows x u8 fault mask
+// stats     request: empty                             reply: u64 requests, u64 batches, u64 rows, u64 cached
+// any reply with Status::error carries the message as its payload; a connection the server refuses gets one such
+// reply and is closed
+enum class Request : std::uint8_t {
+	compile = 1, evaluate = 2, stats = 3
+};
+
+enum class Status : std::uint8_t {
+	ok = 0, error = 1
+};
+
+struct Frame {
+	std::uint8_t kind;
+	std::string payload;
+};
+
+inline constexpr std::size_t max_frame = std::size_t(64) << 20;
+// an evaluate reply spends 9 bytes a row, so no more rows than this fit in one frame
+inline constexpr std::size_t max_rows = (max_frame - sizeof(std::uint32_t)) / (sizeof(double) + sizeof(std::uint8_t));
+
+// blocking, whole frames only: false or nullopt once the peer is gone
+bool send_frame(int, std::uint8_t, std::string_view) noexcept;
+std::optional<Frame> receive_frame(int);
+
+class Writer {
+public:
+	template <typename T> requires std::is_trivially_copyable_v<T>
+	void put(const T& value) {
+		buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+	void put(std::string_view text) {
+		put(static_cast<std::uint32_t>(text.size()));
+		buffer.append(text);
+	}
+	void append(std::string_view bytes) { buffer.append(bytes); }
+
+	const std::string& data() const noexcept { return buffer; }
+private:
+	std::string buffer;
+};
+
+class Reader {
+public:
+	explicit Reader(std::string_view data) noexcept : data(data) {}
+
+	template <typename T> requires std::is_trivially_copyable_v<T>
+	T get() {
+		T value;
+		std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+		return value;
+	}
+	std::string_view text() { return take(get<std::uint32_t>()); }
+	std::string_view take(std::size_t size) {
+		if (size > data.size() - index) {
+			throw std::runtime_error("Malformed frame");
+		}
+		auto bytes = data.substr(index, size);
+		index += size;
+		return bytes;
+	}
+	std::size_t remaining() const noexcept { return data.size() - index; }
+private:
+	std::string_view data;
+	std::size_t index = 0;
+};
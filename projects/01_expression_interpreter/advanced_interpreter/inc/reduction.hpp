@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+
+// min and max skip NaN rows and stay NaN when no row is a number; complex summaries leave them NaN
+template <typename T>
+struct Summary {
+	std::size_t count = 0;
+	std::size_t invalid = 0;
+	T sum = T();
+	T min = T(std::numeric_limits<double>::quiet_NaN());
+	T max = T(std::numeric_limits<double>::quiet_NaN());
+
+	T mean() const noexcept { return count ? sum / T(static_cast<double>(count)) : T(std::numeric_limits<double>::quiet_NaN()); }
+};
+
+// bins split [lo, hi) evenly; rows outside land in below or above, NaN rows in invalid
+struct Histogram {
+	double lo, hi;
+	std::vector<std::size_t> bins;
+	std::size_t below = 0;
+	std::size_t above = 0;
+	std::size_t invalid = 0;
+};
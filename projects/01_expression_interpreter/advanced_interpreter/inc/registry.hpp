@@ -0,0 +1,219 @@
+#pragma once
+
+#include "fastmath.hpp"
+
+#include <string_view>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <complex>
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+#include <utility>
+#include <expected>
+#include <cstdint>
+
+// perfect hash built at compile time: the seed is searched until every id lands in its own slot,
+// so a lookup is one hash, one probe and one compare, and no table is built at startup
+template <typename Entry, std::size_t N>
+class Registry {
+public:
+	static_assert(N < 256);
+	static constexpr std::size_t capacity = std::bit_ceil(4 * N);
+
+	constexpr explicit Registry(const std::array<Entry, N>& entries) : entries(entries) {
+		while (!place()) {
+			++seed;
+		}
+	}
+
+	constexpr const Entry* find(std::string_view id) const noexcept {
+		auto slot = slots[hash(id, seed) & (capacity - 1)];
+		return slot && entries[slot - 1].id == id ? &entries[slot - 1] : nullptr;
+	}
+
+	constexpr auto begin() const noexcept { return entries.begin(); }
+	constexpr auto end() const noexcept { return entries.end(); }
+private:
+	std::array<Entry, N> entries;
+	std::array<std::uint8_t, capacity> slots{};
+	std::uint64_t seed = 0xcbf29ce484222325;
+
+	static constexpr std::uint64_t hash(std::string_view id, std::uint64_t seed) noexcept {
+		for (char c : id) {
+			seed = (seed ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+		}
+		return seed ^ (seed >> 29);
+	}
+
+	constexpr bool place() noexcept {
+		slots.fill(0);
+		for (std::size_t i = 0; i < N; ++i) {
+			auto& slot = slots[hash(entries[i].id, seed) & (capacity - 1)];
+			if (slot) {
+				return false;
+			}
+			slot = static_cast<std::uint8_t>(i + 1);
+		}
+		return true;
+	}
+};
+
+// builtins read their arguments straight from the caller's buffer, so every lookup that hands one out checks the arity
+template <typename T>
+using Native = T (*)(const T*);
+
+template <typename T>
+struct Builtin {
+	std::string_view id;
+	std::size_t arity;
+	// indexed by Accuracy; null where T has no such builtin
+	std::array<Native<T>, 3> call;
+
+	constexpr Native<T> resolve(Accuracy accuracy) const noexcept {
+		return call[std::to_underlying(accuracy)];
+	}
+};
+
+template <typename T>
+struct BinaryOp {
+	std::string_view id;
+	T (*call)(T, T);
+};
+
+template <typename T>
+struct UnaryOp {
+	std::string_view id;
+	T (*call)(T);
+};
+
+struct Constant {
+	std::string_view id;
+	double value;
+};
+
+namespace registry {
+
+template <typename T>
+constexpr std::array<Native<T>, 3> all(Native<T> call) noexcept {
+	return {call, call, call};
+}
+
+template <typename T>
+constexpr auto builtins() {
+	std::array<Builtin<T>, 19> table = {{
+		{"sin", 1, all<T>([](const T* a) -> T { return std::sin(a[0]); })},
+		{"cos", 1, all<T>([](const T* a) -> T { return std::cos(a[0]); })},
+		{"tan", 1, all<T>([](const T* a) -> T { return std::tan(a[0]); })},
+		{"asin", 1, all<T>([](const T* a) -> T { return std::asin(a[0]); })},
+		{"acos", 1, all<T>([](const T* a) -> T { return std::acos(a[0]); })},
+		{"atan", 1, all<T>([](const T* a) -> T { return std::atan(a[0]); })},
+		{"log", 1, all<T>([](const T* a) -> T { return std::log(a[0]); })},
+		{"sqrt", 1, all<T>([](const T* a) -> T { return std::sqrt(a[0]); })},
+		{"exp", 1, all<T>([](const T* a) -> T { return std::exp(a[0]); })},
+		{"pow", 2, all<T>([](const T* a) -> T { return std::pow(a[0], a[1]); })},
+		{"abs", 1, all<T>([](const T* a) -> T { return std::abs(a[0]); })},
+		{"fma", 3, all<T>([](const T* a) -> T {
+			if constexpr (std::floating_point<T>) {
+				return std::fma(a[0], a[1], a[2]);
+			} else {
+				return a[0] * a[1] + a[2];
+			}
+		})},
+		{"sgn", 1, {}},
+		{"ceil", 1, {}},
+		{"floor", 1, {}},
+		{"round", 1, {}},
+		{"min", 2, {}},
+		{"max", 2, {}},
+		{"clamp", 3, {}},
+	}};
+
+	auto set = [&](std::string_view id, Accuracy accuracy, Native<T> call) {
+		std::ranges::find(table, id, &Builtin<T>::id)->call[std::to_underlying(accuracy)] = call;
+	};
+	auto set_all = [&](std::string_view id, Native<T> call) {
+		std::ranges::find(table, id, &Builtin<T>::id)->call = all<T>(call);
+	};
+
+	if constexpr (std::floating_point<T>) {
+		set_all("sgn", [](const T* a) -> T { return a[0] < 0 ? -1 : (a[0] > 0 ? 1 : 0); });
+		set_all("ceil", [](const T* a) -> T { return std::ceil(a[0]); });
+		set_all("floor", [](const T* a) -> T { return std::floor(a[0]); });
+		set_all("round", [](const T* a) -> T { return std::round(a[0]); });
+		set_all("min", [](const T* a) -> T { return std::min(a[0], a[1]); });
+		set_all("max", [](const T* a) -> T { return std::max(a[0], a[1]); });
+		set_all("clamp", [](const T* a) -> T { return std::min(std::max(a[0], a[1]), a[2]); });
+	}
+	if constexpr (std::same_as<T, double>) {
+		set("exp", Accuracy::fast, [](const T* a) -> T { return exp_fast(a[0]); });
+
+		set("exp", Accuracy::approximate, [](const T* a) -> T { return exp_approx(a[0]); });
+		set("log", Accuracy::approximate, [](const T* a) -> T { return log_approx(a[0]); });
+		set("sin", Accuracy::approximate, [](const T* a) -> T { return sin_approx(a[0]); });
+		set("cos", Accuracy::approximate, [](const T* a) -> T { return cos_approx(a[0]); });
+		set("tan", Accuracy::approximate, [](const T* a) -> T { return tan_approx(a[0]); });
+		set("pow", Accuracy::approximate, [](const T* a) -> T { return pow_approx(a[0], a[1]); });
+	}
+	return table;
+}
+
+template <typename T>
+constexpr auto binary_ops() {
+	std::array<BinaryOp<T>, 11> table = {{
+		{"+", [](T a, T b) -> T { return a + b; }},
+		{"-", [](T a, T b) -> T { return a - b; }},
+		{"*", [](T a, T b) -> T { return a * b; }},
+		{"/", [](T a, T b) -> T { return a / b; }},
+		{"^", [](T a, T b) -> T { return std::pow(a, b); }},
+		{"==", [](T a, T b) -> T { return a == b ? T(1) : T(0); }},
+		{"!=", [](T a, T b) -> T { return a != b ? T(1) : T(0); }},
+		{"<", nullptr},
+		{"<=", nullptr},
+		{">", nullptr},
+		{">=", nullptr},
+	}};
+	if constexpr (std::floating_point<T>) {
+		table[7].call = [](T a, T b) -> T { return a < b ? T(1) : T(0); };
+		table[8].call = [](T a, T b) -> T { return a <= b ? T(1) : T(0); };
+		table[9].call = [](T a, T b) -> T { return a > b ? T(1) : T(0); };
+		table[10].call = [](T a, T b) -> T { return a >= b ? T(1) : T(0); };
+	}
+	return table;
+}
+
+template <typename T>
+constexpr auto unary_ops() {
+	return std::array<UnaryOp<T>, 2>{{
+		{"-", [](T a) -> T { return -a; }},
+		{"+", [](T a) -> T { return a; }},
+	}};
+}
+
+}
+
+template <typename T>
+inline constexpr Registry builtin_table{registry::builtins<T>()};
+
+template <typename T>
+inline constexpr Registry binary_table{registry::binary_ops<T>()};
+
+template <typename T>
+inline constexpr Registry unary_table{registry::unary_ops<T>()};
+
+inline constexpr Registry constant_table{std::array<Constant, 2>{{
+	{"pi", std::numbers::pi},
+	{"e", std::numbers::e},
+}}};
+
+// builtin resolution shared by every evaluator: null when the name is not a builtin for T, an error when it is one
+// called with another number of arguments than it reads
+template <typename T>
+constexpr std::expected<Native<T>, std::string_view> builtin(std::string_view id, std::size_t arity, Accuracy accuracy) noexcept {
+	auto entry = builtin_table<T>.find(id);
+	if (entry && entry->arity != arity) {
+		return std::unexpected("Invalid number of arguments");
+	}
+	return entry ? entry->resolve(accuracy) : nullptr;
+}
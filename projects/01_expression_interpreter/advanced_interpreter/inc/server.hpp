@@ -0,0 +1,81 @@
+#pragma once
+
+#include "program.hpp"
+#include "analysis.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <span>
+#include <cstdint>
+
+struct ServerStats {
+	std::uint64_t requests = 0;
+	std::uint64_t batches = 0;
+	std::uint64_t rows = 0;
+	std::uint64_t cached = 0;
+};
+
+// one thread per connection, up to connections of them; expressions compiled by any client are shared by all of them
+// through a bounded LRU, and evaluate requests that meet on the same expression are run as one batch by whichever
+// request arrives first
+class Server {
+public:
+	// compile requests for expressions beyond limits are answered with an error and never cached; a connection past
+	// the limit is sent one error frame and closed, so no client can make the server start threads without bound
+	explicit Server(std::string path, std::size_t capacity = 1024, const Limits& limits = {}, std::size_t connections = 64);
+	~Server();
+
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+	// blocks until stop() is called from another thread or a signal handler
+	void serve();
+	void stop() noexcept;
+
+	ServerStats stats() const;
+private:
+	struct Entry;
+	struct Pending;
+
+	using Order = std::list<std::uint64_t>;
+	struct Slot {
+		std::string text;
+		std::shared_ptr<Entry> entry;
+		Order::iterator position;
+	};
+
+	std::string path;
+	std::size_t capacity;
+	Limits limits;
+	std::size_t connections;
+	int listener = -1;
+	std::atomic<bool> running{false};
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, std::uint64_t> handles;
+	std::unordered_map<std::uint64_t, Slot> entries;
+	Order order;
+	std::uint64_t next = 1;
+
+	std::vector<int> clients;
+	std::vector<std::thread> threads;
+	std::vector<std::thread::id> finished;
+
+	std::atomic<std::uint64_t> requests{0}, batches{0}, rows{0};
+
+	void handle(int);
+	std::string compile(std::string_view);
+	std::string evaluate(std::string_view);
+	std::string report() const;
+
+	std::shared_ptr<Entry> find(std::uint64_t);
+	void run(Entry&, std::span<Pending*>) noexcept;
+	void combine(Entry&, std::span<Pending*>);
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ast.hpp"
+#include "visitor.hpp"
+#include "fastmath.hpp"
+#include "program.hpp"
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <optional>
+#include <string>
+#include <vector>
+#include <complex>
+#include <limits>
+#include <cstdint>
+
+enum class Tier : std::uint8_t {
+	tree, compiling, compiled, failed
+};
+
+struct Tiering {
+	// evaluations on the tree before the expression is compiled: 0 compiles on first use, the maximum never
+	std::uint64_t threshold = 256;
+	// compile on a thread of its own and keep walking the tree until the program is swapped in; the thread is joined
+	// when the last copy of the expression goes
+	bool background = false;
+
+	static constexpr std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
+};
+
+// interpreted counts tree walks toward the threshold: sampled, so it moves in steps, and frozen once the expression
+// leaves the tree; compiled runs are not counted at all
+struct TierStats {
+	Tier tier = Tier::tree;
+	std::uint64_t interpreted = 0;
+};
+
+// per element type, an expression walks its tree until it has been evaluated threshold times, then compiles a Program
+// and publishes it once with a release store; every later evaluation that finds it runs the Program instead and
+// writes nothing shared, so hot threads do not contend on the tiers.
+// user functions are not bound into the Program: each call is forwarded to the map passed to that evaluation,
+// so results and errors stay exactly those of the tree
+class Tiers {
+public:
+	explicit Tiers(Tiering policy = {}) noexcept : policy(policy) {}
+	~Tiers();
+
+	Tiers(const Tiers&) = delete;
+	Tiers& operator=(const Tiers&) = delete;
+
+	// runs the Program, promoting first once the tree has been walked threshold times; null means walk the tree,
+	// which is also the answer when vars lacks a variable: the tree may never read it
+	template <typename T>
+	std::optional<T> run(const Node&, const Variables<T>&, const Functions<T>&, Accuracy);
+	template <typename T>
+	TierStats stats() const noexcept;
+private:
+	template <typename T>
+	struct State {
+		std::atomic<Tier> tier{Tier::tree};
+		std::atomic<const Program<T>*> program{nullptr};
+		std::unique_ptr<const Program<T>> owned;
+		std::atomic<std::uint64_t> interpreted{0};
+		// started by the one evaluation that moved the tier off the tree, joined by the destructor
+		std::thread compiler;
+	};
+
+	Tiering policy;
+	std::tuple<State<float>, State<double>, State<std::complex<double>>> states;
+
+	template <typename T>
+	void promote(const Node&, std::vector<std::string>, Accuracy);
+};
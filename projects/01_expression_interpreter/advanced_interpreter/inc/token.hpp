@@ -5,6 +5,9 @@
 enum class TokenType {
 	ID, NUM,
 	PLUS, MINUS, STAR, SLASH, CARET,
+	LT, LE, GT, GE, EQ, NE,
+	AND, OR, QUESTION, COLON,
+	LET, IN, ASSIGN, SEMICOLON,
 	COMMA, LPAREN, RPAREN,
 	END
 };
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "fastmath.hpp"
+#include "registry.hpp"
+
 #include <string>
 #include <string_view>
 #include <vector>
+#include <span>
 #include <unordered_map>
 #include <functional>
 
@@ -10,65 +14,124 @@ class Visitor {
 public:
 	virtual ~Visitor() noexcept = default;
 
-	virtual void visit(class BinaryNode&) = 0;
-	virtual void visit(class UnaryNode&) = 0;
-	virtual void visit(class GroupNode&) = 0;
-	virtual void visit(class FuncNode&) = 0;
-	virtual void visit(class VarNode&) = 0;
-	virtual void visit(class NumNode&) = 0;
+	virtual void visit(const class BinaryNode&) = 0;
+	virtual void visit(const class UnaryNode&) = 0;
+	virtual void visit(const class LogicalNode&) = 0;
+	virtual void visit(const class CondNode&) = 0;
+	virtual void visit(const class LetNode&) = 0;
+	virtual void visit(const class GroupNode&) = 0;
+	virtual void visit(const class FuncNode&) = 0;
+	virtual void visit(const class VarNode&) = 0;
+	virtual void visit(const class NumNode&) = 0;
 };
 
 class Stringifier : public Visitor {
 public:
-	std::string stringify(class ASTNode&);
-
-	void visit(class BinaryNode&) override;
-	void visit(class UnaryNode&) override;
-	void visit(class GroupNode&) override;
-	void visit(class FuncNode&) override;
-	void visit(class VarNode&) override;
-	void visit(class NumNode&) override;
-private:
+	std::string stringify(const class ASTNode&);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+protected:
 	std::string str = "";
 };
 
 class Printer : public Visitor {
 public:
-	void print(class ASTNode&) noexcept;
-
-	void visit(class BinaryNode&) override;
-	void visit(class UnaryNode&) override;
-	void visit(class GroupNode&) override;
-	void visit(class FuncNode&) override;
-	void visit(class VarNode&) override;
-	void visit(class NumNode&) override;
+	void print(const class ASTNode&) noexcept;
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
 };
 
-class Evaluator : public Visitor {
+template <typename T>
+using Variables = std::unordered_map<std::string_view, T>;
+
+template <typename T>
+using Function = std::function<T(const std::vector<T>&)>;
+
+template <typename T>
+using Functions = std::unordered_map<std::string_view, Function<T>>;
+
+template <typename T>
+using Columns = std::unordered_map<std::string_view, std::span<const T>>;
+
+template <typename T>
+class BasicEvaluator : public Visitor {
 public:
 
-	Evaluator(const std::unordered_map<std::string_view, double>& vars,
-		const std::unordered_map<std::string_view, std::function<double(const std::vector<double>&)>>& funcs) noexcept
-		: vars(vars), funcs(funcs) {}
+	BasicEvaluator(const Variables<T>& vars, const Functions<T>& funcs, Accuracy accuracy = Accuracy::exact)
+		: vars(vars), funcs(funcs), accuracy(accuracy) {}
 
-	double evaluate(class ASTNode&);
+	T evaluate(const class ASTNode&);
 
-	void visit(class BinaryNode&) override;
-	void visit(class UnaryNode&) override;
-	void visit(class GroupNode&) override;
-	void visit(class FuncNode&) override;
-	void visit(class VarNode&) override;
-	void visit(class NumNode&) override;
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
 private:
-	double result = 0.;
+	T result = T();
+	std::vector<T> locals;
+	std::vector<T> stack;
+	std::vector<std::vector<T>> frames;
+	std::size_t base = 0, calls = 0;
 
-	const std::unordered_map<std::string_view, double>& vars;
-	const std::unordered_map<std::string_view, std::function<double(const std::vector<double>&)>>& funcs;
+	const Variables<T>& vars;
+	const Functions<T>& funcs;
+	Accuracy accuracy;
+};
+
+using Evaluator = BasicEvaluator<double>;
+
+// operators and builtins come from the registries, each lifted to a loop over the block with the scalar call inlined
+template <typename T>
+class BatchEvaluator : public Visitor {
+public:
+	static constexpr std::size_t block = 256;
+
+	BatchEvaluator(const Columns<T>& vars, const Functions<T>& funcs, Accuracy accuracy = Accuracy::exact)
+		: vars(vars), funcs(funcs), accuracy(accuracy) {}
+
+	void evaluate(const class ASTNode&, std::span<T>);
+
+	void visit(const class BinaryNode&) override;
+	void visit(const class UnaryNode&) override;
+	void visit(const class LogicalNode&) override;
+	void visit(const class CondNode&) override;
+	void visit(const class LetNode&) override;
+	void visit(const class GroupNode&) override;
+	void visit(const class FuncNode&) override;
+	void visit(const class VarNode&) override;
+	void visit(const class NumNode&) override;
+private:
+	std::vector<T> result;
+	std::vector<std::vector<T>> locals;
+	std::vector<std::vector<T>> stack;
+	std::vector<std::vector<T>> pool;
+	std::size_t offset = 0, size = 0, base = 0;
 
-	static const std::function<void(const std::vector<double>&, std::size_t)> check_args;
+	const Columns<T>& vars;
+	const Functions<T>& funcs;
+	Accuracy accuracy;
 
-	static const std::unordered_map<std::string_view, std::function<double(double, double)>> binary_ops;
-	static const std::unordered_map<std::string_view, std::function<double(double)>> unary_ops;
-	static const std::unordered_map<std::string_view, std::function<double(const std::vector<double>&)>> builtin_funcs;
-	static const std::unordered_map<std::string_view, double> constants;
+	std::vector<T> acquire();
+	void release(std::vector<T>&&);
 };
\ No newline at end of file
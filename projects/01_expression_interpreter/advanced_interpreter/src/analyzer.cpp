@@ -0,0 +1,186 @@
+#include "analysis.hpp"
+
+#include "ast.hpp"
+#include "registry.hpp"
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+namespace {
+
+struct Weight {
+	std::string_view id;
+	double cycles;
+};
+
+// latencies of a typical x86 core for doubles; anything missing costs as much as an add
+constexpr std::array<Weight, 32> weights = {{
+	{"+", 1.}, {"-", 1.}, {"*", 1.}, {"/", 10.}, {"^", 60.},
+	{"==", 1.}, {"!=", 1.}, {"<", 1.}, {"<=", 1.}, {">", 1.}, {">=", 1.},
+	{"u-", 1.}, {"u+", 0.},
+	{"sin", 50.}, {"cos", 50.}, {"tan", 60.}, {"asin", 60.}, {"acos", 60.}, {"atan", 60.},
+	{"log", 40.}, {"exp", 40.}, {"pow", 60.}, {"sqrt", 15.}, {"abs", 1.}, {"fma", 1.},
+	{"sgn", 2.}, {"ceil", 2.}, {"floor", 2.}, {"round", 4.}, {"min", 2.}, {"max", 2.}, {"clamp", 3.},
+}};
+
+constexpr double load = 1., store = 1., branch = 2.;
+// a user function goes through std::function and copies its arguments
+constexpr double call = 40.;
+
+double weight(std::string_view id) noexcept {
+	auto it = std::ranges::find(weights, id, &Weight::id);
+	return it != weights.end() ? it->cycles : 1.;
+}
+
+}
+
+bool Limits::bounded() const noexcept {
+	return nodes != Limits{}.nodes || depth != Limits{}.depth || cycles != Limits{}.cycles || scratch != Limits{}.scratch;
+}
+
+void Limits::admit(const Analysis& analysis) const {
+	if (analysis.depth > depth) {
+		throw std::runtime_error("Expression too deep");
+	}
+	if (analysis.nodes > nodes) {
+		throw std::runtime_error("Expression has too many nodes");
+	}
+	if (analysis.cycles > cycles) {
+		throw std::runtime_error("Expression too expensive");
+	}
+	if (analysis.scratch<double>() > scratch) {
+		throw std::runtime_error("Expression needs too much scratch memory");
+	}
+}
+
+Analysis Analyzer::analyze(const ASTNode& root) {
+	names.clear();
+	level = height = scope = base = calls = 0;
+	descend(root);
+	return std::exchange(analysis, {});
+}
+
+void Analyzer::visit(const BinaryNode& node) {
+	count(node.op, weight(node.op));
+	descend(*node.left);
+	descend(*node.right);
+	--height;
+}
+
+void Analyzer::visit(const UnaryNode& node) {
+	auto id = "u" + std::string(node.op);
+	count(id, weight(id));
+	descend(*node.base);
+}
+
+void Analyzer::visit(const LogicalNode& node) {
+	count(node.op, branch);
+	descend(*node.left);
+	--height;
+	descend(*node.right);
+	--height;
+	push();
+}
+
+void Analyzer::visit(const CondNode& node) {
+	count("?:", branch);
+	descend(*node.cond);
+	--height;
+
+	auto before = analysis.cycles;
+	descend(*node.on_true);
+	auto on_true = std::exchange(analysis.cycles, before) - before;
+	--height;
+	descend(*node.on_false);
+	analysis.cycles = before + std::max(on_true, analysis.cycles - before);
+}
+
+void Analyzer::visit(const LetNode& node) {
+	count("let", 0.);
+	auto outer = scope;
+	for (auto& binding : node.bindings) {
+		descend(*binding.value);
+		--height;
+		analysis.locals = std::max(analysis.locals, base + binding.slot + 1);
+		analysis.cycles += store;
+		scope = binding.slot + 1;
+	}
+	descend(*node.body);
+	scope = outer;
+}
+
+void Analyzer::visit(const GroupNode& node) {
+	descend(*node.base);
+}
+
+void Analyzer::visit(const FuncNode& node) {
+	for (auto& arg : node.args) {
+		descend(*arg);
+	}
+	auto arity = node.args.size();
+
+	// a definition that was too large to inline is a subroutine, whose frame sits right above the caller's locals
+	if (node.definition) {
+		count(node.id, store * static_cast<double>(arity));
+		auto frame = base + scope;
+		height -= arity;
+		analysis.locals = std::max(analysis.locals, frame + arity);
+		auto caller = std::exchange(base, frame);
+		auto outer = std::exchange(scope, arity);
+		analysis.calls = std::max(analysis.calls, ++calls);
+		descend(*node.definition->body);
+		--calls;
+		base = caller;
+		scope = outer;
+		return;
+	}
+
+	if (builtin_table<double>.find(node.id)) {
+		count(node.id, weight(node.id));
+	} else {
+		count(node.id, call + static_cast<double>(arity));
+		analysis.arguments = std::max(analysis.arguments, arity);
+	}
+	height -= arity;
+	push();
+}
+
+void Analyzer::visit(const VarNode& node) {
+	++analysis.nodes;
+	analysis.cycles += load;
+	if (!node.slot && !constant_table.find(node.id) && std::ranges::find(names, node.id) == names.end()) {
+		names.push_back(node.id);
+		++analysis.variables;
+	}
+	push();
+}
+
+void Analyzer::visit(const NumNode&) {
+	++analysis.nodes;
+	analysis.cycles += load;
+	push();
+}
+
+void Analyzer::count(std::string_view id, double cycles) {
+	++analysis.nodes;
+	analysis.cycles += cycles;
+	if (auto it = analysis.operators.find(id); it != analysis.operators.end()) {
+		++it->second;
+	} else {
+		analysis.operators.emplace(id, 1);
+	}
+}
+
+void Analyzer::push() noexcept {
+	analysis.stack = std::max(analysis.stack, ++height);
+}
+
+void Analyzer::descend(const ASTNode& node) {
+	analysis.depth = std::max(analysis.depth, ++level);
+	node.accept(*this);
+	--level;
+}
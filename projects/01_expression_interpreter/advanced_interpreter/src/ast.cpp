@@ -1,26 +1,38 @@
 #include "ast.hpp"
 #include "visitor.hpp"
 
-void BinaryNode::accept(Visitor& visitor) {
+void BinaryNode::accept(Visitor& visitor) const {
 	visitor.visit(*this);
 }
 
-void UnaryNode::accept(Visitor& visitor) {
+void UnaryNode::accept(Visitor& visitor) const {
 	visitor.visit(*this);
 }
 
-void GroupNode::accept(Visitor& visitor) {
+void LogicalNode::accept(Visitor& visitor) const {
 	visitor.visit(*this);
 }
 
-void FuncNode::accept(Visitor& visitor) {
+void CondNode::accept(Visitor& visitor) const {
 	visitor.visit(*this);
 }
 
-void VarNode::accept(Visitor& visitor) {
+void LetNode::accept(Visitor& visitor) const {
 	visitor.visit(*this);
 }
 
-void NumNode::accept(Visitor& visitor) {
+void GroupNode::accept(Visitor& visitor) const {
+	visitor.visit(*this);
+}
+
+void FuncNode::accept(Visitor& visitor) const {
+	visitor.visit(*this);
+}
+
+void VarNode::accept(Visitor& visitor) const {
+	visitor.visit(*this);
+}
+
+void NumNode::accept(Visitor& visitor) const {
 	visitor.visit(*this);
 }
@@ -0,0 +1,325 @@
+#include "visitor.hpp"
+
+#include "ast.hpp"
+#include "fastmath.hpp"
+#include "registry.hpp"
+#include "metrics.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+#include <bit>
+#include <cstdint>
+#include <utility>
+#include <iterator>
+#include <complex>
+#include <cmath>
+#include <expected>
+
+namespace {
+
+template <typename T>
+T select(bool mask, T a, T b) {
+	if constexpr (std::floating_point<T>) {
+		using Bits = std::conditional_t<sizeof(T) == sizeof(std::uint64_t), std::uint64_t, std::uint32_t>;
+		auto bits = -static_cast<Bits>(mask);
+		return std::bit_cast<T>((std::bit_cast<Bits>(a) & bits) | (std::bit_cast<Bits>(b) & ~bits));
+	} else {
+		return mask ? a : b;
+	}
+}
+
+template <typename T, typename F>
+void apply(std::span<const T> a, std::span<T> out, F f) {
+	for (std::size_t i = 0; i < out.size(); ++i) {
+		out[i] = f(a[i]);
+	}
+}
+
+template <typename T, typename F>
+void apply(std::span<const T> a, std::span<const T> b, std::span<T> out, F f) {
+	for (std::size_t i = 0; i < out.size(); ++i) {
+		out[i] = f(a[i], b[i]);
+	}
+}
+
+template <typename T>
+using BinaryKernel = void (*)(std::span<const T>, std::span<const T>, std::span<T>);
+
+template <typename T>
+using UnaryKernel = void (*)(std::span<const T>, std::span<T>);
+
+template <typename T>
+using Kernel = void (*)(const std::vector<std::span<const T>>&, std::span<T>);
+
+// each kernel is instantiated for one registry entry, so its scalar call is a constant the loop can inline
+template <typename T, std::size_t I>
+void binary_kernel(std::span<const T> a, std::span<const T> b, std::span<T> out) {
+	constexpr auto call = binary_table<T>.begin()[I].call;
+	apply(a, b, out, call);
+}
+
+template <typename T, std::size_t I>
+void unary_kernel(std::span<const T> a, std::span<T> out) {
+	constexpr auto call = unary_table<T>.begin()[I].call;
+	apply(a, out, call);
+}
+
+template <typename T, Accuracy A, std::size_t I>
+void builtin_kernel(const std::vector<std::span<const T>>& args, std::span<T> out) {
+	constexpr auto entry = builtin_table<T>.begin()[I];
+	constexpr auto call = entry.resolve(A);
+	std::array<T, entry.arity> row;
+	for (std::size_t i = 0; i < out.size(); ++i) {
+		for (std::size_t j = 0; j < row.size(); ++j) {
+			row[j] = args[j][i];
+		}
+		out[i] = call(row.data());
+	}
+}
+
+// kernels sit at the index of their registry entry; the lookups below skip entries that have no call for T
+template <typename T, std::size_t... I>
+constexpr std::array<BinaryKernel<T>, sizeof...(I)> binary_kernels(std::index_sequence<I...>) {
+	return {binary_kernel<T, I>...};
+}
+
+template <typename T, std::size_t... I>
+constexpr std::array<UnaryKernel<T>, sizeof...(I)> unary_kernels(std::index_sequence<I...>) {
+	return {unary_kernel<T, I>...};
+}
+
+template <typename T, Accuracy A, std::size_t... I>
+constexpr std::array<Kernel<T>, sizeof...(I)> builtin_kernels(std::index_sequence<I...>) {
+	return {builtin_kernel<T, A, I>...};
+}
+
+template <typename Entry, std::size_t N>
+constexpr auto indices(const Registry<Entry, N>&) noexcept {
+	return std::make_index_sequence<N>();
+}
+
+template <typename T>
+BinaryKernel<T> binary_block(std::string_view op) {
+	static constexpr auto kernels = binary_kernels<T>(indices(binary_table<T>));
+	auto entry = binary_table<T>.find(op);
+	return entry && entry->call ? kernels[entry - binary_table<T>.begin()] : nullptr;
+}
+
+template <typename T>
+UnaryKernel<T> unary_block(std::string_view op) {
+	static constexpr auto kernels = unary_kernels<T>(indices(unary_table<T>));
+	auto entry = unary_table<T>.find(op);
+	return entry ? kernels[entry - unary_table<T>.begin()] : nullptr;
+}
+
+template <typename T>
+std::expected<Kernel<T>, std::string_view> builtin_block(std::string_view id, std::size_t arity, Accuracy accuracy) {
+	static constexpr std::array kernels = {
+		builtin_kernels<T, Accuracy::exact>(indices(builtin_table<T>)),
+		builtin_kernels<T, Accuracy::fast>(indices(builtin_table<T>)),
+		builtin_kernels<T, Accuracy::approximate>(indices(builtin_table<T>)),
+	};
+	auto native = builtin<T>(id, arity, accuracy);
+	if (!native) {
+		return std::unexpected(native.error());
+	}
+	return *native ? kernels[std::to_underlying(accuracy)][builtin_table<T>.find(id) - builtin_table<T>.begin()] : nullptr;
+}
+
+}
+
+template <typename T>
+void BatchEvaluator<T>::evaluate(const ASTNode& node, std::span<T> out) {
+
+	for (const auto& [id, column] : vars) {
+		if (column.size() < out.size()) {
+			throw std::runtime_error("Column is shorter than output");
+		}
+	}
+
+	for (offset = 0; offset < out.size(); offset += block) {
+		size = std::min(block, out.size() - offset);
+		node.accept(*this);
+		std::ranges::copy(result, out.begin() + offset);
+		release(std::move(result));
+	}
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const BinaryNode& node) {
+
+	node.left->accept(*this);
+	auto left = std::move(result);
+	node.right->accept(*this);
+
+	auto kernel = binary_block<T>(node.op);
+	if (!kernel) {
+		throw std::runtime_error("Operator not supported");
+	}
+	kernel(left, result, result);
+	release(std::move(left));
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const UnaryNode& node) {
+
+	node.base->accept(*this);
+	auto kernel = unary_block<T>(node.op);
+	if (!kernel) {
+		throw std::runtime_error("Operator not supported");
+	}
+	kernel(result, result);
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const LogicalNode& node) {
+
+	node.left->accept(*this);
+	auto left = std::move(result);
+	node.right->accept(*this);
+
+	// both sides are already computed for the whole block, so there is nothing to short-circuit
+	if (node.op == "&&") {
+		apply<T>(left, result, result, [](T x, T y) -> T { return (x != T(0)) & (y != T(0)) ? T(1) : T(0); });
+	} else if (node.op == "||") {
+		apply<T>(left, result, result, [](T x, T y) -> T { return (x != T(0)) | (y != T(0)) ? T(1) : T(0); });
+	} else {
+		throw std::runtime_error("Operator not supported");
+	}
+	release(std::move(left));
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const CondNode& node) {
+
+	node.cond->accept(*this);
+	auto cond = std::move(result);
+	node.on_true->accept(*this);
+	auto on_true = std::move(result);
+	node.on_false->accept(*this);
+
+	for (std::size_t i = 0; i < size; ++i) {
+		result[i] = select(cond[i] != T(0), on_true[i], result[i]);
+	}
+	release(std::move(cond));
+	release(std::move(on_true));
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const LetNode& node) {
+
+	for (auto& binding : node.bindings) {
+		binding.value->accept(*this);
+		if (locals.size() <= base + binding.slot) {
+			locals.resize(base + binding.slot + 1);
+		}
+		release(std::exchange(locals[base + binding.slot], std::move(result)));
+	}
+	node.body->accept(*this);
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const GroupNode& node) {
+	node.base->accept(*this);
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const FuncNode& node) {
+
+	if (node.definition) {
+		auto mark = stack.size();
+		for (auto& arg : node.args) {
+			arg->accept(*this);
+			stack.push_back(std::move(result));
+		}
+		auto frame = std::exchange(base, locals.size());
+		std::ranges::move(stack.begin() + mark, stack.end(), std::back_inserter(locals));
+		stack.resize(mark);
+		node.definition->body->accept(*this);
+		for (auto i = base; i < locals.size(); ++i) {
+			release(std::move(locals[i]));
+		}
+		locals.resize(base);
+		base = frame;
+		return;
+	}
+
+	std::vector<std::vector<T>> values;
+	for (std::size_t i = 0; i < node.args.size(); ++i) {
+		node.args[i]->accept(*this);
+		values.push_back(std::move(result));
+	}
+	std::vector<std::span<const T>> args(values.begin(), values.end());
+
+	result = acquire();
+	auto kernel = builtin_block<T>(node.id, args.size(), accuracy);
+	if (!kernel) {
+		throw std::runtime_error(std::string(kernel.error()));
+	} else if (*kernel) {
+		(*kernel)(args, result);
+	} else if (auto it = funcs.find(node.id); it != funcs.end()) {
+		std::vector<T> row(args.size());
+		for (std::size_t i = 0; i < size; ++i) {
+			for (std::size_t j = 0; j < args.size(); ++j) {
+				row[j] = args[j][i];
+			}
+			result[i] = it->second(row);
+		}
+	} else {
+		throw std::runtime_error("Function not found");
+	}
+
+	for (auto& value : values) {
+		release(std::move(value));
+	}
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const VarNode& node) {
+
+	result = acquire();
+	if (node.slot) {
+		std::ranges::copy(locals[base + *node.slot], result.begin());
+	} else if (auto constant = constant_table.find(node.id)) {
+		std::ranges::fill(result, static_cast<T>(constant->value));
+	} else if (auto it = vars.find(node.id); it != vars.end()) {
+		std::ranges::copy(it->second.subspan(offset, size), result.begin());
+	} else {
+		throw std::runtime_error("Variable not found");
+	}
+}
+
+template <typename T>
+void BatchEvaluator<T>::visit(const NumNode& node) {
+	result = acquire();
+	std::ranges::fill(result, static_cast<T>(node.value));
+}
+
+template <typename T>
+std::vector<T> BatchEvaluator<T>::acquire() {
+	std::vector<T> buffer;
+	if (!pool.empty()) {
+		buffer = std::move(pool.back());
+		pool.pop_back();
+	} else {
+		Metrics::count(Metric::allocations);
+	}
+	buffer.resize(size);
+	return buffer;
+}
+
+template <typename T>
+void BatchEvaluator<T>::release(std::vector<T>&& buffer) {
+	pool.push_back(std::move(buffer));
+}
+
+template class BatchEvaluator<float>;
+template class BatchEvaluator<double>;
+template class BatchEvaluator<std::complex<double>>;
@@ -0,0 +1,119 @@
+#include "chebyshev.hpp"
+
+#include "expression.hpp"
+#include "program.hpp"
+#include "interval.hpp"
+
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <numbers>
+#include <limits>
+#include <optional>
+
+namespace {
+
+constexpr std::size_t max_pieces = std::size_t(1) << 20;
+constexpr std::size_t samples = 4;
+
+}
+
+Chebyshev::Chebyshev(const Expression& expr, std::string_view var, Interval domain, double tolerance,
+	const Variables<double>& fixed, const Functions<double>& funcs, std::size_t degree)
+	: lo(domain.lo), hi(domain.hi), scale(0.), order(degree + 1) {
+
+	if (domain.empty() || !std::isfinite(lo) || !std::isfinite(hi) || !(lo < hi)) {
+		throw std::runtime_error("Invalid domain");
+	}
+	if (!(tolerance > 0.)) {
+		throw std::runtime_error("Invalid tolerance");
+	}
+
+	auto program = expr.compile<double>(funcs);
+	Context<double> context(program);
+	std::vector<double> row(program.variables().size());
+	std::optional<std::size_t> slot;
+	for (std::size_t i = 0; i < row.size(); ++i) {
+		const auto& id = program.variables()[i];
+		if (id == var) {
+			slot = i;
+		} else if (auto it = fixed.find(id); it != fixed.end()) {
+			row[i] = it->second;
+		} else {
+			throw std::runtime_error("Variable not found");
+		}
+	}
+	auto f = [&](double x) {
+		if (slot) {
+			row[*slot] = x;
+		}
+		auto y = program.run(context, row);
+		if (!std::isfinite(y)) {
+			throw std::runtime_error("Expression is not finite on the domain");
+		}
+		return y;
+	};
+
+	std::vector<double> nodes(order), values(order);
+	for (std::size_t k = 0; k < order; ++k) {
+		nodes[k] = std::cos(std::numbers::pi * (k + 0.5) / order);
+	}
+
+	for (std::size_t count = 1; count <= max_pieces; count *= 2) {
+		auto width = (hi - lo) / count;
+		scale = count / (hi - lo);
+		coeffs.assign(count * order, 0.);
+		max_error = 0.;
+
+		for (std::size_t piece = 0; piece < count && max_error <= tolerance; ++piece) {
+			auto a = lo + piece * width;
+			auto mid = a + width / 2;
+			for (std::size_t k = 0; k < order; ++k) {
+				values[k] = f(mid + nodes[k] * width / 2);
+			}
+
+			auto c = coeffs.data() + piece * order;
+			for (std::size_t j = 0; j < order; ++j) {
+				double sum = 0.;
+				for (std::size_t k = 0; k < order; ++k) {
+					sum += values[k] * std::cos(std::numbers::pi * j * (k + 0.5) / order);
+				}
+				c[j] = (j == 0 ? 1. : 2.) * sum / order;
+			}
+
+			auto checks = samples * order;
+			for (std::size_t k = 0; k <= checks; ++k) {
+				auto t = -1. + 2. * k / checks;
+				max_error = std::max(max_error, std::abs(clenshaw(c, t) - f(mid + t * width / 2)));
+			}
+		}
+
+		if (max_error <= tolerance) {
+			coeffs.shrink_to_fit();
+			return;
+		}
+	}
+	throw std::runtime_error("Tolerance not reached");
+}
+
+double Chebyshev::operator()(double x) const noexcept {
+	if (!(x >= lo && x <= hi)) {
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	auto position = (x - lo) * scale;
+	auto piece = std::min(static_cast<std::size_t>(position), pieces() - 1);
+	auto t = 2. * (position - piece) - 1.;
+	return clenshaw(coeffs.data() + piece * order, t);
+}
+
+double Chebyshev::clenshaw(const double* c, double t) const noexcept {
+	double b1 = 0., b2 = 0.;
+	for (auto j = order; j-- > 1;) {
+		auto b = 2. * t * b1 - b2 + c[j];
+		b2 = b1;
+		b1 = b;
+	}
+	return t * b1 - b2 + c[0];
+}
@@ -0,0 +1,172 @@
+#include "client.hpp"
+
+#include "server.hpp"
+#include "protocol.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+Client::Client(const std::string& path) {
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw std::runtime_error("Socket path too long");
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (socket < 0 || ::connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+		if (socket >= 0) {
+			::close(socket);
+		}
+		throw std::runtime_error("Cannot connect to " + path);
+	}
+}
+
+Client::~Client() {
+	::close(socket);
+}
+
+Compiled Client::compile(std::string_view text) {
+
+	auto reply = call(std::to_underlying(Request::compile), text);
+	Reader reader(reply);
+	Compiled compiled{reader.get<std::uint64_t>(), {}};
+	auto count = reader.get<std::uint32_t>();
+	for (std::uint32_t i = 0; i < count; ++i) {
+		compiled.variables.emplace_back(reader.text());
+	}
+	return compiled;
+}
+
+void Client::evaluate(const Compiled& compiled, std::span<const double> rows, std::span<double> out, std::span<std::uint8_t> faults) {
+
+	auto width = compiled.variables.size();
+	auto count = out.size();
+	if (rows.size() != count * width || faults.size() < count) {
+		throw std::runtime_error("Rows do not match output");
+	}
+	if (count > max_rows) {
+		throw std::runtime_error("Too many rows");
+	}
+
+	Writer writer;
+	writer.put(compiled.handle);
+	writer.put(static_cast<std::uint32_t>(count));
+	writer.append(std::string_view(reinterpret_cast<const char*>(rows.data()), rows.size_bytes()));
+
+	auto reply = call(std::to_underlying(Request::evaluate), writer.data());
+	Reader reader(reply);
+	if (reader.get<std::uint32_t>() != count) {
+		throw std::runtime_error("Malformed frame");
+	}
+	std::memcpy(out.data(), reader.take(count * sizeof(double)).data(), count * sizeof(double));
+	std::memcpy(faults.data(), reader.take(count).data(), count);
+}
+
+ServerStats Client::stats() {
+	auto reply = call(std::to_underlying(Request::stats), {});
+	Reader reader(reply);
+	ServerStats stats;
+	stats.requests = reader.get<std::uint64_t>();
+	stats.batches = reader.get<std::uint64_t>();
+	stats.rows = reader.get<std::uint64_t>();
+	stats.cached = reader.get<std::uint64_t>();
+	return stats;
+}
+
+std::string Client::call(std::uint8_t kind, std::string_view payload) {
+
+	// a refused connection is closed before anything is read from it, but the reason the server sent can still be read
+	auto sent = send_frame(socket, kind, payload);
+	auto frame = receive_frame(socket);
+	if (!frame || (!sent && frame->kind == std::to_underlying(Status::ok))) {
+		throw std::runtime_error("Connection closed");
+	}
+	if (frame->kind != std::to_underlying(Status::ok)) {
+		throw std::runtime_error(frame->payload);
+	}
+	return std::move(frame->payload);
+}
+
+LoadReport load(const std::string& path, const std::vector<std::string>& expressions,
+	std::size_t connections, std::size_t requests, std::size_t rows) {
+
+	if (expressions.empty() || connections == 0) {
+		throw std::runtime_error("Nothing to load");
+	}
+
+	std::vector<std::vector<double>> latencies(connections);
+	std::vector<std::exception_ptr> errors(connections);
+	std::vector<std::thread> workers;
+
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t c = 0; c < connections; ++c) {
+		workers.emplace_back([&, c] {
+			try {
+				Client client(path);
+				std::vector<Compiled> compiled;
+				for (auto& text : expressions) {
+					compiled.push_back(client.compile(text));
+				}
+
+				std::vector<double> input, out(rows);
+				std::vector<std::uint8_t> faults(rows);
+				latencies[c].reserve(requests);
+				for (std::size_t r = 0; r < requests; ++r) {
+					auto& target = compiled[r % compiled.size()];
+					input.resize(rows * target.variables.size());
+					for (std::size_t i = 0; i < input.size(); ++i) {
+						input[i] = static_cast<double>((c * requests + r + i) % 1000) * 1e-3;
+					}
+					auto sent = std::chrono::steady_clock::now();
+					client.evaluate(target, input, out, faults);
+					latencies[c].push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - sent).count());
+				}
+			} catch (...) {
+				errors[c] = std::current_exception();
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	for (auto& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	std::vector<double> all;
+	for (auto& latency : latencies) {
+		all.insert(all.end(), latency.begin(), latency.end());
+	}
+	std::ranges::sort(all);
+
+	LoadReport report;
+	report.requests = all.size();
+	report.rows = all.size() * rows;
+	report.seconds = seconds;
+	if (!all.empty()) {
+		report.p50 = all[all.size() / 2];
+		report.p99 = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+	}
+	report.server = Client(path).stats();
+	return report;
+}
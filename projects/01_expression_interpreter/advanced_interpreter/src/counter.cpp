@@ -0,0 +1,60 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+
+std::size_t Counter::count(const ASTNode& root) {
+	nodes = 0;
+	root.accept(*this);
+	return nodes;
+}
+
+void Counter::visit(const BinaryNode& node) {
+	++nodes;
+	node.left->accept(*this);
+	node.right->accept(*this);
+}
+
+void Counter::visit(const UnaryNode& node) {
+	++nodes;
+	node.base->accept(*this);
+}
+
+void Counter::visit(const LogicalNode& node) {
+	++nodes;
+	node.left->accept(*this);
+	node.right->accept(*this);
+}
+
+void Counter::visit(const CondNode& node) {
+	++nodes;
+	node.cond->accept(*this);
+	node.on_true->accept(*this);
+	node.on_false->accept(*this);
+}
+
+void Counter::visit(const LetNode& node) {
+	++nodes;
+	for (auto& binding : node.bindings) {
+		binding.value->accept(*this);
+	}
+	node.body->accept(*this);
+}
+
+void Counter::visit(const GroupNode& node) {
+	node.base->accept(*this);
+}
+
+void Counter::visit(const FuncNode& node) {
+	++nodes;
+	for (auto& arg : node.args) {
+		arg->accept(*this);
+	}
+}
+
+void Counter::visit(const VarNode&) {
+	++nodes;
+}
+
+void Counter::visit(const NumNode&) {
+	++nodes;
+}
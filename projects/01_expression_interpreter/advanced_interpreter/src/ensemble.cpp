@@ -0,0 +1,310 @@
+#include "ensemble.hpp"
+
+#include "ast.hpp"
+#include "visitor.hpp"
+#include "registry.hpp"
+#include "expression.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <bit>
+#include <complex>
+#include <cstdint>
+
+template <typename T>
+Ensemble<T>::Ensemble(std::span<const Expression> expressions, const Functions<T>& funcs) {
+	Merger<T> merger(*this, funcs);
+	for (auto& expression : expressions) {
+		merger.merge(expression);
+	}
+	merger.finish();
+}
+
+template <typename T>
+void Ensemble<T>::eval(std::span<const T> vars, std::span<T> out) const {
+
+	if (vars.size() < names.size()) {
+		throw std::runtime_error("Missing variable values");
+	}
+	if (out.size() < outputs.size()) {
+		throw std::runtime_error("Output is shorter than ensemble");
+	}
+
+	std::vector<T> registers(names.size() + constants.size() + code.size());
+	auto r = registers.data();
+	std::copy_n(vars.begin(), names.size(), r);
+	std::ranges::copy(constants, r + names.size());
+
+	auto next = r + names.size() + constants.size();
+	for (auto [gate, arg, a, b, c] : code) {
+		switch (gate) {
+			case Gate::add: *next = r[a] + r[b]; break;
+			case Gate::sub: *next = r[a] - r[b]; break;
+			case Gate::mul: *next = r[a] * r[b]; break;
+			case Gate::div: *next = r[a] / r[b]; break;
+			case Gate::neg: *next = -r[a]; break;
+			case Gate::binary: *next = binaries[arg](r[a], r[b]); break;
+			case Gate::native: {
+				T args[3];
+				for (std::uint32_t i = 0; i < b; ++i) {
+					args[i] = r[operands[a + i]];
+				}
+				*next = natives[arg](args);
+				break;
+			}
+			case Gate::call: {
+				std::vector<T> args(b);
+				for (std::uint32_t i = 0; i < b; ++i) {
+					args[i] = r[operands[a + i]];
+				}
+				*next = functions[arg](args);
+				break;
+			}
+			case Gate::both: *next = r[a] != T(0) && r[b] != T(0) ? T(1) : T(0); break;
+			case Gate::either: *next = r[a] != T(0) || r[b] != T(0) ? T(1) : T(0); break;
+			case Gate::select: *next = r[a] != T(0) ? r[b] : r[c]; break;
+		}
+		++next;
+	}
+
+	for (std::size_t i = 0; i < outputs.size(); ++i) {
+		out[i] = r[outputs[i]];
+	}
+}
+
+template <typename T>
+void Ensemble<T>::eval(const Variables<T>& vars, std::span<T> out) const {
+	std::vector<T> values;
+	values.reserve(names.size());
+	for (auto& name : names) {
+		auto it = vars.find(name);
+		if (it == vars.end()) {
+			throw std::runtime_error("Variable not found");
+		}
+		values.push_back(it->second);
+	}
+	eval(values, out);
+}
+
+template <typename T>
+std::size_t Merger<T>::Hash::operator()(const Cell& cell) const noexcept {
+	std::uint64_t h = std::to_underlying(cell.gate);
+	for (std::uint64_t part : {cell.arg, cell.a, cell.b, cell.c}) {
+		h = (h ^ part) * 0x9e3779b97f4a7c15;
+		h ^= h >> 29;
+	}
+	return static_cast<std::size_t>(h);
+}
+
+template <typename T>
+void Merger<T>::merge(const Expression& expression) {
+	accuracy = expression.accuracy;
+	expression.root->accept(*this);
+	ensemble.outputs.push_back(result);
+}
+
+template <typename T>
+void Merger<T>::finish() {
+	for (auto& cell : ensemble.code) {
+		if (cell.gate == Gate::native || cell.gate == Gate::call) {
+			continue;
+		}
+		cell.a = relocate(cell.a);
+		cell.b = relocate(cell.b);
+		cell.c = relocate(cell.c);
+	}
+	for (auto& operand : ensemble.operands) {
+		operand = relocate(operand);
+	}
+	for (auto& output : ensemble.outputs) {
+		output = relocate(output);
+	}
+}
+
+template <typename T>
+void Merger<T>::visit(const BinaryNode& node) {
+
+	node.left->accept(*this);
+	auto left = result;
+	node.right->accept(*this);
+	auto right = result;
+
+	static const std::unordered_map<std::string_view, Gate> gates = {
+		{"+", Gate::add}, {"-", Gate::sub}, {"*", Gate::mul}, {"/", Gate::div},
+	};
+	if (auto it = gates.find(node.op); it != gates.end()) {
+		// IEEE addition and multiplication commute exactly, so x * y and y * x can share a cell
+		if ((it->second == Gate::add || it->second == Gate::mul) && right < left) {
+			std::swap(left, right);
+		}
+		result = emit({it->second, 0, left, right});
+		return;
+	}
+
+	auto op = binary_table<T>.find(node.op);
+	if (!op || !op->call) {
+		throw std::runtime_error("Operator not supported");
+	}
+	auto index = std::ranges::find(ensemble.binaries, op->call) - ensemble.binaries.begin();
+	if (static_cast<std::size_t>(index) == ensemble.binaries.size()) {
+		ensemble.binaries.push_back(op->call);
+	}
+	result = emit({Gate::binary, static_cast<std::uint32_t>(index), left, right});
+}
+
+template <typename T>
+void Merger<T>::visit(const UnaryNode& node) {
+	node.base->accept(*this);
+	if (!unary_table<T>.find(node.op)) {
+		throw std::runtime_error("Operator not supported");
+	}
+	if (node.op == "-") {
+		result = emit({Gate::neg, 0, result});
+	}
+}
+
+template <typename T>
+void Merger<T>::visit(const LogicalNode& node) {
+	node.left->accept(*this);
+	auto left = result;
+	node.right->accept(*this);
+	result = emit({node.op == "&&" ? Gate::both : Gate::either, 0, left, result});
+}
+
+template <typename T>
+void Merger<T>::visit(const CondNode& node) {
+	node.cond->accept(*this);
+	auto cond = result;
+	node.on_true->accept(*this);
+	auto on_true = result;
+	node.on_false->accept(*this);
+	result = on_true == result ? result : emit({Gate::select, 0, cond, on_true, result});
+}
+
+// bindings and parameters are substituted: a let or an inlined call adds no cells of its own
+template <typename T>
+void Merger<T>::visit(const LetNode& node) {
+	for (auto& binding : node.bindings) {
+		binding.value->accept(*this);
+		if (locals.size() <= base + binding.slot) {
+			locals.resize(base + binding.slot + 1);
+		}
+		locals[base + binding.slot] = result;
+	}
+	node.body->accept(*this);
+}
+
+template <typename T>
+void Merger<T>::visit(const GroupNode& node) {
+	node.base->accept(*this);
+}
+
+template <typename T>
+void Merger<T>::visit(const FuncNode& node) {
+
+	std::vector<std::uint32_t> args;
+	for (auto& arg : node.args) {
+		arg->accept(*this);
+		args.push_back(result);
+	}
+
+	if (node.definition) {
+		auto frame = std::exchange(base, locals.size());
+		locals.insert(locals.end(), args.begin(), args.end());
+		node.definition->body->accept(*this);
+		locals.resize(base);
+		base = frame;
+		return;
+	}
+
+	Cell cell;
+	auto native = builtin<T>(node.id, node.args.size(), accuracy);
+	if (!native) {
+		throw std::runtime_error(std::string(native.error()));
+	} else if (*native) {
+		auto index = std::ranges::find(ensemble.natives, *native) - ensemble.natives.begin();
+		if (static_cast<std::size_t>(index) == ensemble.natives.size()) {
+			ensemble.natives.push_back(*native);
+		}
+		cell = {Gate::native, static_cast<std::uint32_t>(index)};
+	} else if (auto it = funcs.find(node.id); it != funcs.end()) {
+		auto [call, inserted] = calls.try_emplace(it->first, static_cast<std::uint32_t>(ensemble.functions.size()));
+		if (inserted) {
+			ensemble.functions.push_back(it->second);
+		}
+		cell = {Gate::call, call->second};
+	} else {
+		throw std::runtime_error("Function not found");
+	}
+
+	// operand lists are shared too: identical argument lists resolve to the same offset
+	auto found = std::ranges::search(ensemble.operands, args);
+	cell.a = static_cast<std::uint32_t>(found.begin() - ensemble.operands.begin());
+	cell.b = static_cast<std::uint32_t>(args.size());
+	if (found.empty() && !args.empty()) {
+		ensemble.operands.insert(ensemble.operands.end(), args.begin(), args.end());
+	}
+	result = emit(cell);
+}
+
+template <typename T>
+void Merger<T>::visit(const VarNode& node) {
+	if (node.slot) {
+		result = locals[base + *node.slot];
+	} else if (auto constant = constant_table.find(node.id)) {
+		result = this->constant(constant->value);
+	} else {
+		auto [it, inserted] = variables.try_emplace(node.id, variable | static_cast<std::uint32_t>(ensemble.names.size()));
+		if (inserted) {
+			ensemble.names.push_back(node.id);
+		}
+		result = it->second;
+	}
+}
+
+template <typename T>
+void Merger<T>::visit(const NumNode& node) {
+	result = constant(node.value);
+}
+
+template <typename T>
+std::uint32_t Merger<T>::emit(Cell cell) {
+	auto [it, inserted] = cells.try_emplace(cell, static_cast<std::uint32_t>(ensemble.code.size()));
+	if (inserted) {
+		ensemble.code.push_back(cell);
+	}
+	return it->second;
+}
+
+template <typename T>
+std::uint32_t Merger<T>::constant(double value) {
+	auto [it, inserted] = constants.try_emplace(std::bit_cast<std::uint64_t>(value), number | static_cast<std::uint32_t>(ensemble.constants.size()));
+	if (inserted) {
+		ensemble.constants.push_back(static_cast<T>(value));
+	}
+	return it->second;
+}
+
+template <typename T>
+std::uint32_t Merger<T>::relocate(std::uint32_t id) const noexcept {
+	if (id & variable) {
+		return id & ~variable;
+	}
+	if (id & number) {
+		return static_cast<std::uint32_t>(ensemble.names.size()) + (id & ~number);
+	}
+	return static_cast<std::uint32_t>(ensemble.names.size() + ensemble.constants.size()) + id;
+}
+
+template class Ensemble<float>;
+template class Ensemble<double>;
+template class Ensemble<std::complex<double>>;
+
+template class Merger<float>;
+template class Merger<double>;
+template class Merger<std::complex<double>>;
@@ -1,60 +1,135 @@
 #include "visitor.hpp"
 
 #include "ast.hpp"
+#include "registry.hpp"
+#include "metrics.hpp"
 
-#include <string_view>
-#include <unordered_map>
+#include <string>
 #include <vector>
-#include <functional>
-#include <cmath>
-#include <numbers>
+#include <stdexcept>
+#include <complex>
+#include <utility>
 
-double Evaluator::evaluate(ASTNode& node) {
+template <typename T>
+T BasicEvaluator<T>::evaluate(const ASTNode& node) {
+	calls = 0;
 	node.accept(*this);
 	return result;
 }
 
-void Evaluator::visit(BinaryNode& node) {
+template <typename T>
+void BasicEvaluator<T>::visit(const BinaryNode& node) {
 
 	node.left->accept(*this);
-	double left = result;
+	T left = result;
 	node.right->accept(*this);
-	double right = result;
+	T right = result;
 
-	result = binary_ops.at(node.op)(left, right);
+	auto op = binary_table<T>.find(node.op);
+	if (!op || !op->call) {
+		throw std::runtime_error("Operator not supported");
+	}
+	result = op->call(left, right);
 }
 
-void Evaluator::visit(UnaryNode& node) {
+template <typename T>
+void BasicEvaluator<T>::visit(const UnaryNode& node) {
 
 	node.base->accept(*this);
-	result = unary_ops.at(node.op)(result);
+	result = unary_table<T>.find(node.op)->call(result);
 }
 
-void Evaluator::visit(GroupNode& node) {
+template <typename T>
+void BasicEvaluator<T>::visit(const LogicalNode& node) {
+
+	node.left->accept(*this);
+	bool left = result != T(0);
+	if (node.op == "&&" ? !left : left) {
+		result = left ? T(1) : T(0);
+		return;
+	}
+	node.right->accept(*this);
+	result = result != T(0) ? T(1) : T(0);
+}
+
+template <typename T>
+void BasicEvaluator<T>::visit(const CondNode& node) {
+
+	node.cond->accept(*this);
+	if (result != T(0)) {
+		node.on_true->accept(*this);
+	} else {
+		node.on_false->accept(*this);
+	}
+}
+
+template <typename T>
+void BasicEvaluator<T>::visit(const LetNode& node) {
+
+	for (auto& binding : node.bindings) {
+		binding.value->accept(*this);
+		if (locals.size() <= base + binding.slot) {
+			locals.resize(base + binding.slot + 1);
+		}
+		locals[base + binding.slot] = result;
+	}
+	node.body->accept(*this);
+}
+
+template <typename T>
+void BasicEvaluator<T>::visit(const GroupNode& node) {
 	node.base->accept(*this);
 }
 
-void Evaluator::visit(FuncNode& node) {
-	
-	std::vector<double> args;
-	for (std::size_t i = 0; i < node.args.size(); ++i) {
-		node.args[i]->accept(*this);
-		args.push_back(result);
+template <typename T>
+void BasicEvaluator<T>::visit(const FuncNode& node) {
+
+	if (node.definition) {
+		auto mark = stack.size();
+		for (auto& arg : node.args) {
+			arg->accept(*this);
+			stack.push_back(result);
+		}
+		auto frame = std::exchange(base, locals.size());
+		locals.insert(locals.end(), stack.begin() + mark, stack.end());
+		stack.resize(mark);
+		node.definition->body->accept(*this);
+		locals.resize(base);
+		base = frame;
+		return;
 	}
 
-	if (auto it = builtin_funcs.find(node.id); it != builtin_funcs.end()) {
-		result = it->second(args);
+	auto level = calls++;
+	if (frames.size() <= level) {
+		frames.emplace_back();
+		Metrics::count(Metric::allocations);
+	}
+	frames[level].clear();
+	for (auto& arg : node.args) {
+		arg->accept(*this);
+		frames[level].push_back(result);
+	}
+
+	auto call = builtin<T>(node.id, node.args.size(), accuracy);
+	if (!call) {
+		throw std::runtime_error(std::string(call.error()));
+	} else if (*call) {
+		result = (*call)(frames[level].data());
 	} else if (auto it = funcs.find(node.id); it != funcs.end()) {
-		result = it->second(args);
+		result = it->second(frames[level]);
 	} else {
 		throw std::runtime_error("Function not found");
 	}
+	--calls;
 }
 
-void Evaluator::visit(VarNode& node) {
+template <typename T>
+void BasicEvaluator<T>::visit(const VarNode& node) {
 
-	if (auto it = constants.find(node.id); it != constants.end()) {
-		result = it->second;
+	if (node.slot) {
+		result = locals[base + *node.slot];
+	} else if (auto constant = constant_table.find(node.id)) {
+		result = static_cast<T>(constant->value);
 	} else if (auto it = vars.find(node.id); it != vars.end()) {
 		result = it->second;
 	} else {
@@ -62,48 +137,11 @@ void Evaluator::visit(VarNode& node) {
 	}
 }
 
-void Evaluator::visit(NumNode& node) {
-	result = node.value;
+template <typename T>
+void BasicEvaluator<T>::visit(const NumNode& node) {
+	result = static_cast<T>(node.value);
 }
 
-const std::function<void(const std::vector<double>& args, std::size_t n)> Evaluator::check_args = [](const std::vector<double>& args, std::size_t n) {
-	if (args.size() != n) {
-		throw std::runtime_error("Invalid number of arguments");
-	}
-};
-
-const std::unordered_map<std::string_view, std::function<double(double, double)>> Evaluator::binary_ops = {
-	{"+", std::plus<double>()},
-	{"-", std::minus<double>()},
-	{"*", std::multiplies<double>()},
-	{"/", std::divides<double>()},
-	{"^", [](double a, double b) -> double { return std::pow(a, b); }},
-};
-
-const std::unordered_map<std::string_view, std::function<double(double)>> Evaluator::unary_ops = {
-	{"-", std::negate<double>()},
-	{"+", std::identity()}
-};
-
-const std::unordered_map<std::string_view, std::function<double(const std::vector<double>&)>> Evaluator::builtin_funcs = {
-	{"sin", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::sin(args[0]); }},
-	{"cos", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::cos(args[0]); }},
-	{"tan", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::tan(args[0]); }},
-	{"asin", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::asin(args[0]); }},
-	{"acos", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::acos(args[0]); }},
-	{"atan", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::atan(args[0]); }},
-	{"log", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::log(args[0]); }},
-	{"sqrt", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::sqrt(args[0]); }},
-	{"exp", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::exp(args[0]); }},
-	{"pow", [](const std::vector<double>& args) -> double { check_args(args, 2); return std::pow(args[0], args[1]); }},
-	{"sgn", [](const std::vector<double>& args) -> double { check_args(args, 1); return args[0] < 0 ? -1 : (args[0] > 0 ? 1 : 0); }},
-	{"abs", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::abs(args[0]); }},
-	{"ceil", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::ceil(args[0]); }},
-	{"floor", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::floor(args[0]); }},
-	{"round", [](const std::vector<double>& args) -> double { check_args(args, 1); return std::round(args[0]); }},
-};
-
-const std::unordered_map<std::string_view, double> Evaluator::constants = {
-	{"pi", std::numbers::pi},
-	{"e", std::numbers::e}
-};
+template class BasicEvaluator<float>;
+template class BasicEvaluator<double>;
+template class BasicEvaluator<std::complex<double>>;
@@ -7,17 +7,173 @@
 #include "parser.hpp"
 
 #include "visitor.hpp"
+#include "profiler.hpp"
+#include "interval.hpp"
+#include "fastmath.hpp"
+#include "library.hpp"
+#include "metrics.hpp"
+#include "passes.hpp"
+#include "program.hpp"
+#include "tier.hpp"
+#include "analysis.hpp"
 
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <functional>
+#include <span>
+#include <complex>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <concepts>
+#include <cmath>
+#include <expected>
+#include <stdexcept>
+#include <utility>
+#include <memory>
 
-Expression::Expression(const std::string& input) : input(input), root(nullptr) {
-	Lexer lexer(input);
-	auto&& tokens = lexer.tokenize();
-	Parser parser(std::move(tokens));
+namespace {
+
+constexpr std::size_t grid_tile = 16;
+constexpr std::size_t reduce_chunk = 64 * BatchEvaluator<double>::block;
+
+template <typename F>
+void parallel(std::size_t threads, F work) {
+	std::vector<std::thread> workers;
+	std::vector<std::exception_ptr> errors(std::max<std::size_t>(threads, 1));
+	for (std::size_t t = 1; t < errors.size(); ++t) {
+		workers.emplace_back([&, t] {
+			try {
+				work();
+			} catch (...) {
+				errors[t] = std::current_exception();
+			}
+		});
+	}
+	try {
+		work();
+	} catch (...) {
+		errors[0] = std::current_exception();
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	for (auto& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+template <typename T>
+void neumaier(T& sum, T& compensation, T value) noexcept {
+	if constexpr (std::floating_point<T>) {
+		auto total = sum + value;
+		compensation += std::abs(sum) >= std::abs(value) ? (sum - total) + value : (value - total) + sum;
+		sum = total;
+	} else {
+		typename T::value_type real = sum.real(), imag = sum.imag(), carry_real = compensation.real(), carry_imag = compensation.imag();
+		neumaier(real, carry_real, value.real());
+		neumaier(imag, carry_imag, value.imag());
+		sum = {real, imag};
+		compensation = {carry_real, carry_imag};
+	}
+}
+
+template <typename T>
+struct Partial {
+	Summary<T> summary;
+	T compensation = T();
+
+	void merge(const Partial& other) {
+		summary.count += other.summary.count;
+		summary.invalid += other.summary.invalid;
+		neumaier(summary.sum, compensation, other.summary.sum);
+		neumaier(summary.sum, compensation, other.compensation);
+		if constexpr (std::floating_point<T>) {
+			summary.min = std::fmin(summary.min, other.summary.min);
+			summary.max = std::fmax(summary.max, other.summary.max);
+		}
+	}
+
+	// the compensation holds what the running sum lost; once the sum overflows it is NaN, so it is left out
+	Summary<T> total() const {
+		auto result = summary;
+		if constexpr (std::floating_point<T>) {
+			if (std::isfinite(result.sum)) {
+				result.sum += compensation;
+			}
+		} else {
+			auto real = result.sum.real(), imag = result.sum.imag();
+			result.sum = {std::isfinite(real) ? real + compensation.real() : real, std::isfinite(imag) ? imag + compensation.imag() : imag};
+		}
+		return result;
+	}
+};
+
+struct Bins {
+	Histogram histogram;
+
+	void merge(const Bins& other) {
+		for (std::size_t i = 0; i < histogram.bins.size(); ++i) {
+			histogram.bins[i] += other.histogram.bins[i];
+		}
+		histogram.below += other.histogram.below;
+		histogram.above += other.histogram.above;
+		histogram.invalid += other.histogram.invalid;
+	}
+};
+
+// merges neighbours level by level, so the result depends only on the chunking and never on the thread count
+template <typename R>
+R pairwise(std::vector<R> partials) {
+	for (std::size_t width = 1; width < partials.size(); width *= 2) {
+		for (std::size_t i = 0; i + width < partials.size(); i += 2 * width) {
+			partials[i].merge(partials[i + width]);
+		}
+	}
+	return std::move(partials.front());
+}
+
+}
+
+Expression::Expression(const std::string& input, Accuracy accuracy) : Expression(input, Library(), accuracy) {}
+
+Expression::Expression(const std::string& input, const Library& library, Accuracy accuracy, const Limits& limits)
+	: root(nullptr), accuracy(accuracy), tiers(std::make_shared<Tiers>()) {
+	Parser parser{Lexer(input), limits.depth};
 	root = parser.parse();
+
+	Stopwatch watch;
+	Inliner inliner(library);
+	inliner.expand(root);
+
+	Optimizer optimizer(0, accuracy);
+	optimizer.optimize(root);
+	Metrics::record(Phase::optimize, watch.elapsed());
+
+	if (limits.bounded()) {
+		limits.admit(analyze());
+	}
+	Metrics::count(Metric::expressions);
+}
+
+Expression::Expression(Node root, Accuracy accuracy) : root(std::move(root)), accuracy(accuracy), tiers(std::make_shared<Tiers>()) {
+	Metrics::count(Metric::expressions);
+}
+
+std::expected<Expression, std::string> Expression::parse(const std::string& input, Accuracy accuracy) noexcept {
+	return parse(input, Library(), accuracy);
+}
+
+std::expected<Expression, std::string> Expression::parse(const std::string& input, const Library& library, Accuracy accuracy, const Limits& limits) noexcept {
+	try {
+		return Expression(input, library, accuracy, limits);
+	} catch (const std::exception& error) {
+		return std::unexpected(error.what());
+	}
 }
 
 void Expression::print() const noexcept {
@@ -30,10 +186,270 @@ std::string Expression::to_string() const noexcept {
 	return stringifier.stringify(*root);
 }
 
-double Expression::eval(const std::unordered_map<std::string_view, double>& vars,
-	const std::unordered_map<std::string_view, std::function<double(const std::vector<double>&)>>& funcs) const {
+Analysis Expression::analyze() const {
+	Analyzer analyzer;
+	return analyzer.analyze(*root);
+}
+
+template <typename T>
+T Expression::eval(const Variables<T>& vars, const Functions<T>& funcs) const {
 	
-	Evaluator evaluator(vars, funcs);
+	Stopwatch watch;
+	if (auto result = tiers->run(root, vars, funcs, accuracy)) {
+		Metrics::record(Phase::eval, watch.elapsed());
+		return *result;
+	}
+	BasicEvaluator<T> evaluator(vars, funcs, accuracy);
+
+	auto result = evaluator.evaluate(*root);
+	Metrics::record(Phase::eval, watch.elapsed());
+	return result;
+}
+
+void Expression::tiering(const Tiering& policy) {
+	tiers = std::make_shared<Tiers>(policy);
+}
+
+template <typename T>
+TierStats Expression::tier_stats() const noexcept {
+	return tiers->stats<T>();
+}
+
+template TierStats Expression::tier_stats<float>() const noexcept;
+template TierStats Expression::tier_stats<double>() const noexcept;
+template TierStats Expression::tier_stats<std::complex<double>>() const noexcept;
+
+template <typename T>
+void Expression::eval(const Columns<T>& vars, const Functions<T>& funcs, std::span<T> out) const {
+
+	BatchEvaluator<T> evaluator(vars, funcs, accuracy);
+
+	evaluator.evaluate(*root, out);
+}
+
+template float Expression::eval(const Variables<float>&, const Functions<float>&) const;
+template double Expression::eval(const Variables<double>&, const Functions<double>&) const;
+template std::complex<double> Expression::eval(const Variables<std::complex<double>>&, const Functions<std::complex<double>>&) const;
+
+template void Expression::eval(const Columns<float>&, const Functions<float>&, std::span<float>) const;
+template void Expression::eval(const Columns<double>&, const Functions<double>&, std::span<double>) const;
+template void Expression::eval(const Columns<std::complex<double>>&, const Functions<std::complex<double>>&, std::span<std::complex<double>>) const;
+
+template <typename T>
+Program<T> Expression::compile(const Functions<T>& funcs) const {
+
+	auto program = bind(funcs);
+	if (!program) {
+		throw std::runtime_error(program.error());
+	}
+	return std::move(*program);
+}
+
+template <typename T>
+std::expected<Program<T>, std::string> Expression::bind(const Functions<T>& funcs) const {
+
+	Stopwatch watch;
+	Compiler<T> compiler(funcs, accuracy);
+
+	auto program = compiler.compile(*root);
+	Metrics::record(Phase::bind, watch.elapsed());
+	return program;
+}
+
+template Program<float> Expression::compile(const Functions<float>&) const;
+template Program<double> Expression::compile(const Functions<double>&) const;
+template Program<std::complex<double>> Expression::compile(const Functions<std::complex<double>>&) const;
+
+template std::expected<Program<float>, std::string> Expression::bind(const Functions<float>&) const;
+template std::expected<Program<double>, std::string> Expression::bind(const Functions<double>&) const;
+template std::expected<Program<std::complex<double>>, std::string> Expression::bind(const Functions<std::complex<double>>&) const;
+
+template <typename T>
+void Expression::grid(std::string_view column, std::span<const T> columns, std::string_view row, std::span<const T> rows,
+	std::span<T> out, const Variables<T>& fixed, const Functions<T>& funcs, std::size_t threads) const {
+
+	if (out.size() < columns.size() * rows.size()) {
+		throw std::runtime_error("Output is smaller than grid");
+	}
+
+	auto residual = root;
+	auto hoisted = Hoister(column, row).hoist(residual);
+
+	Variables<T> invariants = fixed;
+	for (auto& [id, value, per_row] : hoisted) {
+		if (!per_row) {
+			invariants[id] = BasicEvaluator<T>(fixed, funcs, accuracy).evaluate(*value);
+		}
+	}
+
+	std::atomic<std::size_t> next = 0;
+	auto work = [&] {
+		std::vector<std::vector<T>> broadcast;
+		Columns<T> vars = {{column, columns}};
+		auto share = [&](std::string_view id, T value) {
+			broadcast.emplace_back(columns.size(), value);
+			vars[id] = broadcast.back();
+		};
+		broadcast.reserve(invariants.size() + hoisted.size() + 1);
+		for (const auto& [id, value] : invariants) {
+			if (id != column) {
+				share(id, value);
+			}
+		}
+		auto first = broadcast.size();
+		share(row, T());
+		for (auto& [id, value, per_row] : hoisted) {
+			if (per_row) {
+				share(id, T());
+			}
+		}
+
+		Variables<T> scalars = invariants;
+		BatchEvaluator<T> evaluator(vars, funcs, accuracy);
+		for (std::size_t tile; (tile = next.fetch_add(grid_tile)) < rows.size();) {
+			for (auto r = tile; r < std::min(tile + grid_tile, rows.size()); ++r) {
+				scalars[row] = rows[r];
+				std::ranges::fill(broadcast[first], rows[r]);
+				auto slot = first + 1;
+				for (auto& [id, value, per_row] : hoisted) {
+					if (per_row) {
+						std::ranges::fill(broadcast[slot++], BasicEvaluator<T>(scalars, funcs, accuracy).evaluate(*value));
+					}
+				}
+				evaluator.evaluate(*residual, out.subspan(r * columns.size(), columns.size()));
+			}
+		}
+	};
+
+	parallel(threads, work);
+}
+
+template void Expression::grid(std::string_view, std::span<const float>, std::string_view, std::span<const float>, std::span<float>,
+	const Variables<float>&, const Functions<float>&, std::size_t) const;
+template void Expression::grid(std::string_view, std::span<const double>, std::string_view, std::span<const double>, std::span<double>,
+	const Variables<double>&, const Functions<double>&, std::size_t) const;
+template void Expression::grid(std::string_view, std::span<const std::complex<double>>, std::string_view, std::span<const std::complex<double>>,
+	std::span<std::complex<double>>, const Variables<std::complex<double>>&, const Functions<std::complex<double>>&, std::size_t) const;
+
+template <typename T, typename R, typename F>
+R Expression::fuse(const Columns<T>& vars, const Functions<T>& funcs, std::size_t threads, const R& init, F fold) const {
+
+	if (vars.empty()) {
+		throw std::runtime_error("Reduction needs at least one column");
+	}
+	auto rows = vars.begin()->second.size();
+	for (const auto& [id, column] : vars) {
+		if (column.size() != rows) {
+			throw std::runtime_error("Columns differ in length");
+		}
+	}
+
+	std::vector<R> partials(std::max<std::size_t>((rows + reduce_chunk - 1) / reduce_chunk, 1), init);
+	std::atomic<std::size_t> next = 0;
+	parallel(threads, [&] {
+		constexpr auto block = BatchEvaluator<T>::block;
+		Columns<T> window = vars;
+		std::vector<T> out(block);
+		BatchEvaluator<T> evaluator(window, funcs, accuracy);
+		for (std::size_t chunk; (chunk = next++) < partials.size();) {
+			auto end = std::min((chunk + 1) * reduce_chunk, rows);
+			for (auto start = chunk * reduce_chunk; start < end; start += block) {
+				auto size = std::min(block, end - start);
+				for (auto& [id, column] : window) {
+					column = vars.at(id).subspan(start, size);
+				}
+				evaluator.evaluate(*root, std::span(out).first(size));
+				fold(partials[chunk], std::span<const T>(out).first(size));
+			}
+		}
+	});
+	return pairwise(std::move(partials));
+}
+
+template <typename T>
+Summary<T> Expression::reduce(const Columns<T>& vars, const Functions<T>& funcs, std::size_t threads) const {
+	return fuse(vars, funcs, threads, Partial<T>(), [](Partial<T>& partial, std::span<const T> values) {
+		auto& summary = partial.summary;
+		for (const auto& value : values) {
+			if (value != value) {
+				++summary.invalid;
+			} else if constexpr (std::floating_point<T>) {
+				summary.min = std::fmin(summary.min, value);
+				summary.max = std::fmax(summary.max, value);
+			}
+			neumaier(summary.sum, partial.compensation, value);
+		}
+		summary.count += values.size();
+	}).total();
+}
+
+template Summary<float> Expression::reduce(const Columns<float>&, const Functions<float>&, std::size_t) const;
+template Summary<double> Expression::reduce(const Columns<double>&, const Functions<double>&, std::size_t) const;
+template Summary<std::complex<double>> Expression::reduce(const Columns<std::complex<double>>&, const Functions<std::complex<double>>&, std::size_t) const;
+
+Histogram Expression::histogram(const Columns<double>& vars, double lo, double hi, std::size_t bins,
+	const Functions<double>& funcs, std::size_t threads) const {
+
+	if (bins == 0 || !(lo < hi) || !std::isfinite(hi - lo)) {
+		throw std::runtime_error("Invalid histogram range");
+	}
+	auto scale = bins / (hi - lo);
+	return fuse(vars, funcs, threads, Bins{{lo, hi, std::vector<std::size_t>(bins)}}, [&](Bins& partial, std::span<const double> values) {
+		auto& histogram = partial.histogram;
+		for (auto value : values) {
+			if (value != value) {
+				++histogram.invalid;
+			} else if (value < lo) {
+				++histogram.below;
+			} else if (value >= hi) {
+				++histogram.above;
+			} else {
+				++histogram.bins[std::min(static_cast<std::size_t>((value - lo) * scale), bins - 1)];
+			}
+		}
+	}).histogram;
+}
+
+Expression Expression::specialize(const Variables<double>& bindings) const {
+
+	Stopwatch watch;
+	auto specialized = root;
+
+	Specializer specializer(bindings, accuracy);
+	specializer.specialize(specialized);
+
+	Optimizer optimizer(0, accuracy);
+	optimizer.optimize(specialized);
+	Metrics::record(Phase::optimize, watch.elapsed());
+
+	return Expression(std::move(specialized), accuracy);
+}
+
+Expression Expression::substitute(std::string_view id, const Expression& value) const {
+
+	auto substituted = root;
+	Substituter substituter(id, value.root);
+	substituter.substitute(substituted);
+
+	return Expression(std::move(substituted), accuracy);
+}
+
+Interval Expression::bound(const Box& vars) const {
+
+	IntervalEvaluator evaluator(vars);
 
 	return evaluator.evaluate(*root);
-}
\ No newline at end of file
+}
+
+CullResult Expression::cull(const Box& domain, Interval target, std::size_t depth) const {
+	return ::cull(*root, domain, target, depth);
+}
+
+#ifdef PROFILING
+double Expression::profile(const Variables<double>& vars, const Functions<double>& funcs, Profile& profile) const {
+
+	ProfilingEvaluator evaluator(vars, funcs, profile, accuracy);
+
+	return evaluator.evaluate(*root);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "fastmath.hpp"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+namespace {
+
+constexpr double ln2_hi = 0x1.62e42fee00000p-1;
+constexpr double ln2_lo = 0x1.a39ef35793c76p-33;
+
+constexpr double pio2_1 = 0x1.921fb54400000p0;
+constexpr double pio2_2 = 0x1.0b4611a600000p-34;
+constexpr double pio2_3 = 0x1.3198a2e037073p-69;
+
+constexpr double shifter = 0x1.8p52;
+
+template <std::size_t N>
+constexpr std::array<double, N> taylor(std::size_t start, std::size_t step, bool alternate) {
+	std::array<double, N> coeffs{};
+	for (std::size_t i = 0; i < N; ++i) {
+		double term = 1.;
+		for (std::size_t k = 2; k <= start + i * step; ++k) {
+			term /= static_cast<double>(k);
+		}
+		coeffs[i] = alternate && i % 2 ? -term : term;
+	}
+	return coeffs;
+}
+
+template <std::size_t N>
+double horner(double x, const std::array<double, N>& coeffs) noexcept {
+	double acc = coeffs[N - 1];
+	for (std::size_t i = N - 1; i-- > 0;) {
+		acc = acc * x + coeffs[i];
+	}
+	return acc;
+}
+
+double scale(double p, long k) noexcept {
+	if (k > 1023) {
+		return p * 2. * std::bit_cast<double>(static_cast<std::uint64_t>(2046) << 52);
+	}
+	return p * std::bit_cast<double>(static_cast<std::uint64_t>(k + 1023) << 52);
+}
+
+// 2^(j/128) split into the nearest double and the remainder, so the table adds no rounding of its own
+struct Exp2 {
+	double hi, lo;
+};
+
+const std::array<Exp2, 128> exp2_table = [] {
+	std::array<Exp2, 128> table{};
+	for (std::size_t j = 0; j < table.size(); ++j) {
+		auto exact = std::exp2(static_cast<long double>(j) / 128);
+		table[j].hi = static_cast<double>(exact);
+		table[j].lo = static_cast<double>(exact - table[j].hi);
+	}
+	return table;
+}();
+
+// exp(x) = 2^(n/128) * exp(r) with |r| <= ln2/256; coeffs approximate (exp(r) - 1) / r
+template <std::size_t N>
+double exp_kernel(double x, const std::array<double, N>& coeffs) noexcept {
+	if (!(x < 709.78 && x > -708.39)) {
+		return std::exp(x);
+	}
+	auto k = (x * (128 * std::numbers::log2e) + shifter) - shifter;
+	auto r = (x - k * (ln2_hi / 128)) - k * (ln2_lo / 128);
+	auto n = static_cast<long>(k);
+	auto [hi, lo] = exp2_table[n & 127];
+	return scale(hi + (lo + hi * (r * horner(r, coeffs))), n >> 7);
+}
+
+// log(x) = k ln2 + log(c) + log(1 + r) with c = 1 + j/128 the left end of m's interval, so m - c is exact and
+// r = (m - c) / c costs a multiply; m just below 2 is halved to sit just below c = 1, which keeps log(x) near 0 relative
+struct Log {
+	double inverse, log;
+};
+
+const std::array<Log, 128> log_table = [] {
+	std::array<Log, 128> table{};
+	for (std::size_t j = 0; j < table.size(); ++j) {
+		auto c = 1 + static_cast<long double>(j) / 128;
+		table[j].inverse = static_cast<double>(1 / c);
+		table[j].log = static_cast<double>(std::log(c));
+	}
+	return table;
+}();
+
+// coeffs approximate log(1 + r) / r for |r| < 1/128
+template <std::size_t N>
+double log_kernel(double x, const std::array<double, N>& coeffs) noexcept {
+	if (!(x >= 0x1p-1022 && x <= 0x1.fffffffffffffp1023)) {
+		return std::log(x);
+	}
+	auto bits = std::bit_cast<std::uint64_t>(x);
+	auto e = static_cast<long>(bits >> 52) - 1023;
+	auto m = std::bit_cast<double>((bits & 0xfffffffffffffull) | 0x3ff0000000000000ull);
+	auto j = static_cast<std::size_t>(bits >> 45) & 127;
+	if (m >= 2 - 0x1p-8) {
+		m /= 2;
+		++e;
+		j = 0;
+	}
+	auto [inverse, log] = log_table[j];
+	auto r = (m - (1 + static_cast<double>(j) / 128)) * inverse;
+	return static_cast<double>(e) * std::numbers::ln2 + (log + r * horner(r, coeffs));
+}
+
+// x - k pi/2 as r + lo, which keeps the bits the three-part subtraction would otherwise round away
+struct Reduced {
+	double r, lo;
+	long quadrant;
+};
+
+Reduced reduce(double x) noexcept {
+	auto k = (x * (2 / std::numbers::pi) + shifter) - shifter;
+	// the first two products are exact and so is the first difference; the other two are summed with their errors
+	auto head = x - k * pio2_1;
+	auto middle = k * pio2_2;
+	auto a = head - middle;
+	auto tail = k * pio2_3;
+	auto r = a - tail;
+	return {r, ((a - r) - tail) + ((head - a) - middle), static_cast<long>(k) & 3};
+}
+
+constexpr auto exp_fast_coeffs = taylor<6>(1, 1, false);
+constexpr auto exp_approx_coeffs = taylor<3>(1, 1, false);
+
+// log(1 + r) / r = 1 - r/2 + r^2/3 - ...
+template <std::size_t N>
+constexpr std::array<double, N> log_series() {
+	std::array<double, N> coeffs{};
+	for (std::size_t i = 0; i < N; ++i) {
+		coeffs[i] = (i % 2 ? -1. : 1.) / static_cast<double>(i + 1);
+	}
+	return coeffs;
+}
+
+template <std::size_t N>
+constexpr std::array<double, N> negated(std::array<double, N> coeffs) {
+	for (auto& c : coeffs) {
+		c = -c;
+	}
+	return coeffs;
+}
+
+constexpr auto log_approx_coeffs = log_series<3>();
+
+// sin r = r + r^3 S(r^2), cos r = 1 - r^2/2 + r^4 C(r^2)
+constexpr auto sin_approx_coeffs = negated(taylor<3>(3, 2, true));
+constexpr auto cos_approx_coeffs = taylor<3>(4, 2, true);
+
+// a value kept as a head and a much smaller tail that has not been added to it yet
+struct Sum {
+	double head, tail;
+
+	double value() const noexcept { return head + tail; }
+};
+
+template <std::size_t N>
+Sum sin_poly(const Reduced& x, const std::array<double, N>& coeffs) noexcept {
+	auto z = x.r * x.r;
+	return {x.r, x.r * z * horner(z, coeffs) + x.lo * (1 - z / 2)};
+}
+
+// 1 - z/2 is rounded once and its error carried in the tail, as fdlibm's __kernel_cos does
+template <std::size_t N>
+Sum cos_poly(const Reduced& x, const std::array<double, N>& coeffs) noexcept {
+	auto z = x.r * x.r;
+	auto half = z / 2;
+	auto w = 1 - half;
+	return {w, ((1 - w) - half) + (z * z * horner(z, coeffs) - x.r * x.lo)};
+}
+
+template <std::size_t S, std::size_t C>
+double sin_kernel(double x, const std::array<double, S>& sin_coeffs, const std::array<double, C>& cos_coeffs) noexcept {
+	if (!(std::abs(x) < 0x1p16)) {
+		return std::sin(x);
+	}
+	auto reduced = reduce(x);
+	switch (reduced.quadrant) {
+		case 0: return sin_poly(reduced, sin_coeffs).value();
+		case 1: return cos_poly(reduced, cos_coeffs).value();
+		case 2: return -sin_poly(reduced, sin_coeffs).value();
+		default: return -cos_poly(reduced, cos_coeffs).value();
+	}
+}
+
+template <std::size_t S, std::size_t C>
+double cos_kernel(double x, const std::array<double, S>& sin_coeffs, const std::array<double, C>& cos_coeffs) noexcept {
+	if (!(std::abs(x) < 0x1p16)) {
+		return std::cos(x);
+	}
+	auto reduced = reduce(x);
+	switch (reduced.quadrant) {
+		case 0: return cos_poly(reduced, cos_coeffs).value();
+		case 1: return -sin_poly(reduced, sin_coeffs).value();
+		case 2: return -cos_poly(reduced, cos_coeffs).value();
+		default: return sin_poly(reduced, sin_coeffs).value();
+	}
+}
+
+template <std::size_t S, std::size_t C>
+double tan_kernel(double x, const std::array<double, S>& sin_coeffs, const std::array<double, C>& cos_coeffs) noexcept {
+	if (!(std::abs(x) < 0x1p16)) {
+		return std::tan(x);
+	}
+	auto reduced = reduce(x);
+	auto s = sin_poly(reduced, sin_coeffs).value();
+	auto c = cos_poly(reduced, cos_coeffs).value();
+	return reduced.quadrant % 2 ? -c / s : s / c;
+}
+
+}
+
+double exp_fast(double x) noexcept {
+	return exp_kernel(x, exp_fast_coeffs);
+}
+
+double exp_approx(double x) noexcept {
+	return exp_kernel(x, exp_approx_coeffs);
+}
+
+double log_approx(double x) noexcept {
+	return log_kernel(x, log_approx_coeffs);
+}
+
+double sin_approx(double x) noexcept {
+	return sin_kernel(x, sin_approx_coeffs, cos_approx_coeffs);
+}
+
+double cos_approx(double x) noexcept {
+	return cos_kernel(x, sin_approx_coeffs, cos_approx_coeffs);
+}
+
+double tan_approx(double x) noexcept {
+	return tan_kernel(x, sin_approx_coeffs, cos_approx_coeffs);
+}
+
+double pow_approx(double x, double y) noexcept {
+	if (!(x > 0 && std::isfinite(x) && std::isfinite(y))) {
+		return std::pow(x, y);
+	}
+	return exp_approx(y * std::log(x));
+}
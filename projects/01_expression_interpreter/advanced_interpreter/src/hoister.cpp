@@ -0,0 +1,173 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <utility>
+
+namespace {
+
+constexpr unsigned inner_bit = 1, outer_bit = 2, local_bit = 4;
+
+bool leaf(const ASTNode& node) {
+	return dynamic_cast<const VarNode*>(&node) || dynamic_cast<const NumNode*>(&node);
+}
+
+}
+
+std::vector<Hoisted> Hoister::hoist(Node& root) {
+	auto dependencies = scan(root);
+	mask = inner_bit;
+	lift(root, dependencies);
+	return std::move(hoisted);
+}
+
+void Hoister::visit(const BinaryNode& node) {
+	auto left = node.left, right = node.right;
+	auto lhs = scan(left);
+	auto rhs = scan(right);
+	mask = lhs | rhs;
+	lift(left, lhs);
+	lift(right, rhs);
+	if (left != node.left || right != node.right) {
+		replacement = std::make_shared<BinaryNode>(node.op, std::move(left), std::move(right));
+	}
+}
+
+void Hoister::visit(const UnaryNode& node) {
+	auto base = node.base;
+	mask = scan(base);
+	lift(base, mask);
+	if (base != node.base) {
+		replacement = std::make_shared<UnaryNode>(node.op, std::move(base));
+	}
+}
+
+void Hoister::visit(const LogicalNode& node) {
+	auto left = node.left, right = node.right;
+	auto lhs = scan(left);
+	auto rhs = scan(right);
+	mask = lhs | rhs;
+	lift(left, lhs);
+	lift(right, rhs);
+	if (left != node.left || right != node.right) {
+		replacement = std::make_shared<LogicalNode>(node.op, std::move(left), std::move(right));
+	}
+}
+
+void Hoister::visit(const CondNode& node) {
+	auto cond = node.cond, on_true = node.on_true, on_false = node.on_false;
+	auto masks = std::array{scan(cond), scan(on_true), scan(on_false)};
+	mask = masks[0] | masks[1] | masks[2];
+	lift(cond, masks[0]);
+	lift(on_true, masks[1]);
+	lift(on_false, masks[2]);
+	if (cond != node.cond || on_true != node.on_true || on_false != node.on_false) {
+		replacement = std::make_shared<CondNode>(std::move(cond), std::move(on_true), std::move(on_false));
+	}
+}
+
+void Hoister::visit(const LetNode& node) {
+	std::vector<Binding> bindings;
+	std::vector<unsigned> values;
+	for (auto& binding : node.bindings) {
+		auto value = binding.value;
+		values.push_back(scan(value));
+		slots[binding.slot] = values.back() | local_bit;
+		bindings.emplace_back(binding.id, binding.slot, std::move(value));
+	}
+	auto body = node.body;
+	auto dependencies = scan(body);
+
+	mask = dependencies;
+	for (auto value : values) {
+		mask |= value;
+	}
+	auto changed = false;
+	for (std::size_t i = 0; i < bindings.size(); ++i) {
+		lift(bindings[i].value, values[i]);
+		changed |= bindings[i].value != node.bindings[i].value;
+	}
+	lift(body, dependencies);
+	if (changed || body != node.body) {
+		replacement = std::make_shared<LetNode>(std::move(bindings), std::move(body));
+	}
+}
+
+void Hoister::visit(const GroupNode& node) {
+	auto base = node.base;
+	mask = scan(base);
+	lift(base, mask);
+	if (base != node.base) {
+		replacement = std::make_shared<GroupNode>(std::move(base));
+	}
+}
+
+void Hoister::visit(const FuncNode& node) {
+	auto args = node.args;
+	std::vector<unsigned> masks;
+	for (auto& arg : args) {
+		masks.push_back(scan(arg));
+	}
+
+	mask = node.definition ? body(*node.definition) : 0;
+	for (auto arg : masks) {
+		mask |= arg;
+	}
+	for (std::size_t i = 0; i < args.size(); ++i) {
+		lift(args[i], masks[i]);
+	}
+	if (args != node.args) {
+		replacement = std::make_shared<FuncNode>(node.id, std::move(args), node.definition);
+	}
+}
+
+void Hoister::visit(const VarNode& node) {
+	if (node.slot) {
+		mask = slots.at(*node.slot);
+	} else if (node.id == inner) {
+		mask = inner_bit;
+	} else if (node.id == outer) {
+		mask = outer_bit;
+	} else {
+		mask = 0;
+	}
+}
+
+void Hoister::visit(const NumNode&) {
+	mask = 0;
+}
+
+// a linked definition depends on the loop variables its body reads besides its parameters, which the arguments cover;
+// the body itself stays whole, since every call site shares it
+unsigned Hoister::body(const Definition& definition) {
+	if (auto it = bodies.find(&definition); it != bodies.end()) {
+		return it->second;
+	}
+	Hoister callee(inner, outer);
+	for (std::size_t slot = 0; slot < definition.params.size(); ++slot) {
+		callee.slots[slot] = 0;
+	}
+	auto copy = definition.body;
+	auto dependencies = callee.scan(copy) & (inner_bit | outer_bit);
+	bodies.emplace(&definition, dependencies);
+	return dependencies;
+}
+
+unsigned Hoister::scan(Node& node) {
+	rewrite(node);
+	return mask;
+}
+
+// mask holds the parent: children are lifted only out of a parent that stays in the loop, so lifted subtrees are maximal
+void Hoister::lift(Node& node, unsigned dependencies) {
+	if ((mask & (inner_bit | local_bit)) == 0 || (dependencies & (inner_bit | local_bit)) != 0 || leaf(*node)) {
+		return;
+	}
+	auto id = "$" + std::to_string(hoisted.size());
+	hoisted.push_back({id, std::move(node), (dependencies & outer_bit) != 0});
+	node = std::make_shared<VarNode>(id);
+}
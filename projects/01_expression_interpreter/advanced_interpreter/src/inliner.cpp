@@ -0,0 +1,52 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+#include "library.hpp"
+#include "registry.hpp"
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+
+void Inliner::expand(Node& node) {
+	rewrite(node);
+}
+
+void Inliner::visit(const FuncNode& node) {
+	auto args = node.args;
+	for (auto& arg : args) {
+		expand(arg);
+	}
+
+	auto definition = library.find(node.id);
+	if (!definition) {
+		if (auto entry = builtin_table<double>.find(node.id); entry && entry->arity != args.size()) {
+			throw std::runtime_error("Invalid number of arguments");
+		}
+		if (args != node.args) {
+			replacement = std::make_shared<FuncNode>(node.id, std::move(args), node.definition);
+		}
+		return;
+	}
+	if (definition->params.size() != args.size()) {
+		throw std::runtime_error("Invalid number of arguments");
+	}
+	if (!library.inlinable(*definition)) {
+		replacement = std::make_shared<FuncNode>(node.id, std::move(args), std::move(definition));
+		return;
+	}
+
+	// every call site at the same depth shares the definition body instead of copying it
+	auto body = Relocator(0, depth).relocate(definition->body);
+	if (args.empty()) {
+		replacement = std::make_shared<GroupNode>(std::move(body));
+		return;
+	}
+
+	std::vector<Binding> bindings;
+	for (std::size_t i = 0; i < args.size(); ++i) {
+		bindings.emplace_back(definition->params[i], depth + i, Relocator(depth, i).relocate(std::move(args[i])));
+	}
+	replacement = std::make_shared<GroupNode>(std::make_shared<LetNode>(std::move(bindings), std::move(body)));
+}
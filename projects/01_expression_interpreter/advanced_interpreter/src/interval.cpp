@@ -0,0 +1,429 @@
+#include "interval.hpp"
+
+#include "ast.hpp"
+#include "registry.hpp"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <initializer_list>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr double inf = std::numeric_limits<double>::infinity();
+
+Interval widen(Interval x, int ulps) {
+	if (x.empty()) {
+		return Interval::none();
+	}
+	for (int i = 0; i < ulps; ++i) {
+		x.lo = std::nextafter(x.lo, -inf);
+		x.hi = std::nextafter(x.hi, inf);
+	}
+	return x;
+}
+
+Interval hull(std::initializer_list<double> values) {
+	Interval x = Interval::none();
+	for (auto value : values) {
+		x.lo = std::fmin(x.lo, value);
+		x.hi = std::fmax(x.hi, value);
+	}
+	return x;
+}
+
+bool hits(Interval x, double offset, double period) {
+	auto k = std::ceil((x.lo - offset) / period - 1e-9);
+	return offset + k * period <= x.hi + 1e-9 * std::max(1., std::abs(x.hi));
+}
+
+bool is_integer(Interval x) {
+	return x.lo == x.hi && std::isfinite(x.lo) && std::trunc(x.lo) == x.lo;
+}
+
+Interval add(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	Interval r{a.lo + b.lo, a.hi + b.hi};
+	if (std::isnan(r.lo)) r.lo = -inf;
+	if (std::isnan(r.hi)) r.hi = inf;
+	return widen(r, 1);
+}
+
+Interval sub(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	Interval r{a.lo - b.hi, a.hi - b.lo};
+	if (std::isnan(r.lo)) r.lo = -inf;
+	if (std::isnan(r.hi)) r.hi = inf;
+	return widen(r, 1);
+}
+
+Interval mul(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	auto r = hull({a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi});
+	if (r.empty()) return Interval::entire();
+	return widen(r, 1);
+}
+
+Interval divide(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	if (b.contains(0.)) return Interval::entire();
+	auto r = hull({a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi});
+	if (r.empty()) return Interval::entire();
+	return widen(r, 1);
+}
+
+Interval ipow(Interval x, double n) {
+	if (n == 0.) return Interval::point(1.);
+
+	auto lo = std::pow(x.lo, n);
+	auto hi = std::pow(x.hi, n);
+	bool even = std::fmod(n, 2.) == 0.;
+
+	if (x.contains(0.)) {
+		if (n > 0.) {
+			return widen(even ? Interval{0., std::max(lo, hi)} : Interval{lo, hi}, 2);
+		}
+		return even ? Interval{0., inf} : Interval::entire();
+	}
+	return widen(hull({lo, hi}), 2);
+}
+
+Interval power(Interval x, Interval y) {
+	if (x.empty() || y.empty()) return Interval::none();
+
+	if (is_integer(y)) {
+		return ipow(x, y.lo);
+	}
+
+	if (x.lo >= 0.) {
+		return widen(hull({std::pow(x.lo, y.lo), std::pow(x.lo, y.hi), std::pow(x.hi, y.lo), std::pow(x.hi, y.hi)}), 2);
+	}
+
+	auto m = std::max(std::abs(x.lo), std::abs(x.hi));
+	auto r = hull({std::pow(m, y.lo), std::pow(m, y.hi), std::pow(0., y.lo), std::pow(0., y.hi)});
+	return widen({-r.hi, r.hi}, 2);
+}
+
+Interval sin(Interval x) {
+	if (x.empty()) return Interval::none();
+	if (!std::isfinite(x.lo) || !std::isfinite(x.hi) || x.width() >= 2 * std::numbers::pi) return {-1., 1.};
+	auto r = hull({std::sin(x.lo), std::sin(x.hi)});
+	if (hits(x, std::numbers::pi / 2, 2 * std::numbers::pi)) r.hi = 1.;
+	if (hits(x, -std::numbers::pi / 2, 2 * std::numbers::pi)) r.lo = -1.;
+	r = widen(r, 2);
+	return {std::max(r.lo, -1.), std::min(r.hi, 1.)};
+}
+
+Interval cos(Interval x) {
+	if (x.empty()) return Interval::none();
+	if (!std::isfinite(x.lo) || !std::isfinite(x.hi) || x.width() >= 2 * std::numbers::pi) return {-1., 1.};
+	auto r = hull({std::cos(x.lo), std::cos(x.hi)});
+	if (hits(x, 0., 2 * std::numbers::pi)) r.hi = 1.;
+	if (hits(x, std::numbers::pi, 2 * std::numbers::pi)) r.lo = -1.;
+	r = widen(r, 2);
+	return {std::max(r.lo, -1.), std::min(r.hi, 1.)};
+}
+
+Interval tan(Interval x) {
+	if (x.empty()) return Interval::none();
+	if (!std::isfinite(x.lo) || !std::isfinite(x.hi) || x.width() >= std::numbers::pi) return Interval::entire();
+	if (hits(x, std::numbers::pi / 2, std::numbers::pi)) return Interval::entire();
+	return widen({std::tan(x.lo), std::tan(x.hi)}, 2);
+}
+
+template <typename F>
+Interval increasing(Interval x, Interval domain, F f) {
+	if (x.empty() || !x.intersects(domain)) return Interval::none();
+	return widen({f(std::max(x.lo, domain.lo)), f(std::min(x.hi, domain.hi))}, 2);
+}
+
+template <typename F>
+Interval exact(Interval x, F f) {
+	if (x.empty()) return Interval::none();
+	return {f(x.lo), f(x.hi)};
+}
+
+constexpr Interval no{0., 0.};
+constexpr Interval yes{1., 1.};
+constexpr Interval maybe{0., 1.};
+
+Interval less(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	if (a.hi < b.lo) return yes;
+	if (a.lo >= b.hi) return no;
+	return maybe;
+}
+
+Interval less_equal(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	if (a.hi <= b.lo) return yes;
+	if (a.lo > b.hi) return no;
+	return maybe;
+}
+
+Interval equal(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	if (a.lo == a.hi && b.lo == b.hi && a.lo == b.lo) return yes;
+	if (!a.intersects(b)) return no;
+	return maybe;
+}
+
+Interval negate(Interval x) {
+	if (x.empty()) return x;
+	return {1. - x.hi, 1. - x.lo};
+}
+
+Interval truth(Interval x) {
+	if (x.empty()) return Interval::none();
+	if (x.lo == 0. && x.hi == 0.) return no;
+	if (!x.contains(0.)) return yes;
+	return maybe;
+}
+
+Interval join(Interval a, Interval b) {
+	if (a.empty()) return b;
+	if (b.empty()) return a;
+	return {std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+}
+
+Interval min(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	return {std::min(a.lo, b.lo), std::min(a.hi, b.hi)};
+}
+
+Interval max(Interval a, Interval b) {
+	if (a.empty() || b.empty()) return Interval::none();
+	return {std::max(a.lo, b.lo), std::max(a.hi, b.hi)};
+}
+
+bool same(const ASTNode& a, const ASTNode& b) {
+	auto x = dynamic_cast<const VarNode*>(&a);
+	auto y = dynamic_cast<const VarNode*>(&b);
+	return x && y && x->id == y->id && x->slot == y->slot;
+}
+
+Interval abs(Interval x) {
+	if (x.empty()) return Interval::none();
+	if (x.contains(0.)) return {0., std::max(-x.lo, x.hi)};
+	return hull({std::abs(x.lo), std::abs(x.hi)});
+}
+
+// the same registries as the scalar evaluators, with enclosures in place of values
+constexpr Registry interval_binaries{std::array<BinaryOp<Interval>, 11>{{
+	{"+", add},
+	{"-", sub},
+	{"*", mul},
+	{"/", divide},
+	{"^", power},
+	{"<", less},
+	{"<=", less_equal},
+	{">", [](Interval a, Interval b) -> Interval { return less(b, a); }},
+	{">=", [](Interval a, Interval b) -> Interval { return less_equal(b, a); }},
+	{"==", equal},
+	{"!=", [](Interval a, Interval b) -> Interval { return negate(equal(a, b)); }},
+}}};
+
+constexpr Registry interval_unaries{std::array<UnaryOp<Interval>, 2>{{
+	{"-", [](Interval x) -> Interval { return x.empty() ? x : Interval{-x.hi, -x.lo}; }},
+	{"+", [](Interval x) -> Interval { return x; }},
+}}};
+
+constexpr Registry interval_builtins{std::array<Builtin<Interval>, 19>{{
+	{"sin", 1, registry::all<Interval>([](const Interval* a) -> Interval { return sin(a[0]); })},
+	{"cos", 1, registry::all<Interval>([](const Interval* a) -> Interval { return cos(a[0]); })},
+	{"tan", 1, registry::all<Interval>([](const Interval* a) -> Interval { return tan(a[0]); })},
+	{"asin", 1, registry::all<Interval>([](const Interval* a) -> Interval { return increasing(a[0], {-1., 1.}, [](double x) { return std::asin(x); }); })},
+	{"acos", 1, registry::all<Interval>([](const Interval* a) -> Interval { auto r = increasing(a[0], {-1., 1.}, [](double x) { return -std::acos(x); }); return r.empty() ? r : Interval{-r.hi, -r.lo}; })},
+	{"atan", 1, registry::all<Interval>([](const Interval* a) -> Interval { return increasing(a[0], Interval::entire(), [](double x) { return std::atan(x); }); })},
+	{"log", 1, registry::all<Interval>([](const Interval* a) -> Interval { return increasing(a[0], {0., inf}, [](double x) { return std::log(x); }); })},
+	{"sqrt", 1, registry::all<Interval>([](const Interval* a) -> Interval { auto r = increasing(a[0], {0., inf}, [](double x) { return std::sqrt(x); }); return r.empty() ? r : Interval{std::max(r.lo, 0.), r.hi}; })},
+	{"exp", 1, registry::all<Interval>([](const Interval* a) -> Interval { auto r = increasing(a[0], Interval::entire(), [](double x) { return std::exp(x); }); return r.empty() ? r : Interval{std::max(r.lo, 0.), r.hi}; })},
+	{"pow", 2, registry::all<Interval>([](const Interval* a) -> Interval { return power(a[0], a[1]); })},
+	{"sgn", 1, registry::all<Interval>([](const Interval* a) -> Interval { return exact(a[0], [](double x) -> double { return x < 0 ? -1 : (x > 0 ? 1 : 0); }); })},
+	{"abs", 1, registry::all<Interval>([](const Interval* a) -> Interval { return abs(a[0]); })},
+	{"ceil", 1, registry::all<Interval>([](const Interval* a) -> Interval { return exact(a[0], [](double x) { return std::ceil(x); }); })},
+	{"floor", 1, registry::all<Interval>([](const Interval* a) -> Interval { return exact(a[0], [](double x) { return std::floor(x); }); })},
+	{"round", 1, registry::all<Interval>([](const Interval* a) -> Interval { return exact(a[0], [](double x) { return std::round(x); }); })},
+	{"min", 2, registry::all<Interval>([](const Interval* a) -> Interval { return min(a[0], a[1]); })},
+	{"max", 2, registry::all<Interval>([](const Interval* a) -> Interval { return max(a[0], a[1]); })},
+	{"clamp", 3, registry::all<Interval>([](const Interval* a) -> Interval { return min(max(a[0], a[1]), a[2]); })},
+	{"fma", 3, registry::all<Interval>([](const Interval* a) -> Interval { return add(mul(a[0], a[1]), a[2]); })},
+}}};
+
+}
+
+Interval IntervalEvaluator::evaluate(const ASTNode& node) {
+	node.accept(*this);
+	return result;
+}
+
+void IntervalEvaluator::visit(const BinaryNode& node) {
+
+	node.left->accept(*this);
+	auto left = result;
+	node.right->accept(*this);
+	auto right = result;
+
+	if (node.op == "*" && same(*node.left, *node.right)) {
+		result = ipow(left, 2.);
+	} else {
+		auto op = interval_binaries.find(node.op);
+		if (!op) {
+			throw std::runtime_error("Operator not supported");
+		}
+		result = op->call(left, right);
+	}
+}
+
+void IntervalEvaluator::visit(const UnaryNode& node) {
+
+	node.base->accept(*this);
+	auto op = interval_unaries.find(node.op);
+	if (!op) {
+		throw std::runtime_error("Operator not supported");
+	}
+	result = op->call(result);
+}
+
+void IntervalEvaluator::visit(const LogicalNode& node) {
+
+	node.left->accept(*this);
+	auto left = truth(result);
+	node.right->accept(*this);
+	auto right = truth(result);
+
+	if (left.empty() || right.empty()) {
+		result = Interval::none();
+	} else if (node.op == "&&") {
+		result = {std::min(left.lo, right.lo), std::min(left.hi, right.hi)};
+	} else {
+		result = {std::max(left.lo, right.lo), std::max(left.hi, right.hi)};
+	}
+}
+
+void IntervalEvaluator::visit(const CondNode& node) {
+
+	node.cond->accept(*this);
+	auto cond = truth(result);
+
+	if (cond.empty()) {
+		result = Interval::none();
+	} else if (cond.lo == 1.) {
+		node.on_true->accept(*this);
+	} else if (cond.hi == 0.) {
+		node.on_false->accept(*this);
+	} else {
+		node.on_true->accept(*this);
+		auto on_true = result;
+		node.on_false->accept(*this);
+		result = join(on_true, result);
+	}
+}
+
+void IntervalEvaluator::visit(const LetNode& node) {
+
+	for (auto& binding : node.bindings) {
+		binding.value->accept(*this);
+		if (locals.size() <= base + binding.slot) {
+			locals.resize(base + binding.slot + 1);
+		}
+		locals[base + binding.slot] = result;
+	}
+	node.body->accept(*this);
+}
+
+void IntervalEvaluator::visit(const GroupNode& node) {
+	node.base->accept(*this);
+}
+
+void IntervalEvaluator::visit(const FuncNode& node) {
+
+	if (node.definition) {
+		auto mark = stack.size();
+		for (auto& arg : node.args) {
+			arg->accept(*this);
+			stack.push_back(result);
+		}
+		auto frame = std::exchange(base, locals.size());
+		locals.insert(locals.end(), stack.begin() + mark, stack.end());
+		stack.resize(mark);
+		node.definition->body->accept(*this);
+		locals.resize(base);
+		base = frame;
+		return;
+	}
+
+	std::vector<Interval> args;
+	for (std::size_t i = 0; i < node.args.size(); ++i) {
+		node.args[i]->accept(*this);
+		args.push_back(result);
+	}
+
+	if (auto entry = interval_builtins.find(node.id); entry && entry->arity == args.size()) {
+		result = entry->resolve(Accuracy::exact)(args.data());
+	} else {
+		result = Interval::entire();
+	}
+}
+
+void IntervalEvaluator::visit(const VarNode& node) {
+
+	if (node.slot) {
+		result = locals[base + *node.slot];
+	} else if (auto constant = constant_table.find(node.id)) {
+		result = Interval::point(constant->value);
+	} else if (auto it = vars.find(node.id); it != vars.end()) {
+		result = it->second;
+	} else {
+		throw std::runtime_error("Variable not found");
+	}
+}
+
+void IntervalEvaluator::visit(const NumNode& node) {
+	result = Interval::point(node.value);
+}
+
+CullResult cull(const ASTNode& root, const Box& domain, Interval target, std::size_t depth) {
+	CullResult culling;
+	std::vector<std::pair<Box, std::size_t>> pending = {{domain, 0}};
+
+	while (!pending.empty()) {
+		auto [box, level] = std::move(pending.back());
+		pending.pop_back();
+
+		IntervalEvaluator evaluator(box);
+		auto bound = evaluator.evaluate(root);
+		++culling.bounded;
+
+		if (!bound.intersects(target)) {
+			++culling.culled;
+			culling.culled_fraction += std::ldexp(1., -static_cast<int>(level));
+			continue;
+		}
+
+		if (level == depth || box.empty()) {
+			culling.regions.push_back(std::move(box));
+			continue;
+		}
+
+		auto widest = std::ranges::max_element(box, {}, [](const auto& var) { return var.second.width(); });
+		auto [lo, hi] = widest->second;
+		auto split = widest->second.mid();
+
+		auto left = box;
+		left[widest->first] = {lo, split};
+		box[widest->first] = {split, hi};
+
+		pending.emplace_back(std::move(box), level + 1);
+		pending.emplace_back(std::move(left), level + 1);
+	}
+
+	return culling;
+}
@@ -1,35 +1,77 @@
 #include "lexer.hpp"
 
 #include "token.hpp"
+#include "registry.hpp"
+#include "metrics.hpp"
 
-#include <vector>
-#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <array>
+#include <initializer_list>
+#include <utility>
 
 #include <stdexcept>
 
-std::vector<Token> Lexer::tokenize() {
-	std::vector<Token> tokens;
+namespace {
+
+struct Symbol {
+	std::string_view id;
+	TokenType type;
+};
+
+constexpr Registry keywords{std::array<Symbol, 2>{{
+	{"let", TokenType::LET},
+	{"in", TokenType::IN},
+}}};
+
+constexpr Registry ops{std::array<Symbol, 20>{{
+	{"+", TokenType::PLUS},
+	{"-", TokenType::MINUS},
+	{"*", TokenType::STAR},
+	{"/", TokenType::SLASH},
+	{"^", TokenType::CARET},
+	{"<", TokenType::LT},
+	{"<=", TokenType::LE},
+	{">", TokenType::GT},
+	{">=", TokenType::GE},
+	{"==", TokenType::EQ},
+	{"!=", TokenType::NE},
+	{"&&", TokenType::AND},
+	{"||", TokenType::OR},
+	{"?", TokenType::QUESTION},
+	{":", TokenType::COLON},
+	{"=", TokenType::ASSIGN},
+	{";", TokenType::SEMICOLON},
+	{",", TokenType::COMMA},
+	{"(", TokenType::LPAREN},
+	{")", TokenType::RPAREN},
+}}};
 
-	while (index < input.length()) {
-		auto token = extract();
-		tokens.push_back(token);
-	}
+}
 
-	return tokens;
+// END is sticky: pulling past the end of input keeps returning it
+Token Lexer::next() {
+	if (lookahead.type == TokenType::END) {
+		return lookahead;
+	}
+	Stopwatch watch;
+	auto token = std::exchange(lookahead, extract());
+	spent += watch.elapsed();
+	return token;
 }
 
 Token Lexer::extract() {
-	while (std::isblank(peek())) advance();
+	while (std::isblank(at())) skip();
 
 	if (index >= input.length()) {
 		return Token{TokenType::END};
 	}
 
-	if (std::isalpha(peek()) || peek() == '_' ) {
+	if (std::isalpha(at()) || at() == '_' ) {
 		return extract_id();
 	}
 
-	if (std::isdigit(peek())) {
+	if (std::isdigit(at())) {
 		return extract_num();
 	}
 
@@ -38,47 +80,41 @@ Token Lexer::extract() {
 
 Token Lexer::extract_id() {
 	auto start = index;
-	while (std::isalnum(peek()) || peek() == '_') advance();
+	while (std::isalnum(at()) || at() == '_') skip();
 	auto value = input.substr(start, index - start);
+	if (auto keyword = keywords.find(value)) {
+		return {keyword->type, value};
+	}
 	return {TokenType::ID, value};
 }
 
 Token Lexer::extract_num() {
 	auto start = index;
-	while (std::isdigit(peek())) advance();
-	if (peek() == '.') {
-		advance();
-		while (std::isdigit(peek())) advance();
+	while (std::isdigit(at())) skip();
+	if (at() == '.') {
+		skip();
+		while (std::isdigit(at())) skip();
 	}
 	auto value = input.substr(start, index - start);
 	return {TokenType::NUM, value};
 }
 
 Token Lexer::extract_op() {
-	static const std::unordered_map<std::string_view, TokenType> ops = {
-		{"+", TokenType::PLUS},
-		{"-", TokenType::MINUS},
-		{"*", TokenType::STAR},
-		{"/", TokenType::SLASH},
-		{"^", TokenType::CARET},
-		{",", TokenType::COMMA},
-		{"(", TokenType::LPAREN},
-		{")", TokenType::RPAREN},
-	};
-
-	if (auto it = ops.find(input.substr(index, 1)); it != ops.end()) {
-		advance();
-		return {it->second, it->first};
+	for (std::size_t length : {2, 1}) {
+		if (auto op = ops.find(input.substr(index, length))) {
+			skip(length);
+			return {op->type, op->id};
+		}
 	}
 
-	report("Invalid character" + peek());
+	report("Invalid character: " + std::string(1, at()));
 }
 
-char Lexer::peek(std::size_t offset) const noexcept {
-	return input[index + offset];
+char Lexer::at(std::size_t offset) const noexcept {
+	return index + offset < input.length() ? input[index + offset] : '\0';
 }
 
-void Lexer::advance(std::size_t offset) noexcept {
+void Lexer::skip(std::size_t offset) noexcept {
 	index += offset;
 }
 
@@ -0,0 +1,39 @@
+#include "library.hpp"
+
+#include "ast.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "passes.hpp"
+#include "metrics.hpp"
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <utility>
+
+void Library::define(const std::string& input) {
+	Parser parser{Lexer(input)};
+	auto definition = parser.parse_definition();
+
+	Stopwatch watch;
+	Inliner inliner(*this, definition.params.size());
+	inliner.expand(definition.body);
+
+	Optimizer optimizer(definition.params.size());
+	optimizer.optimize(definition.body);
+	Metrics::record(Phase::optimize, watch.elapsed());
+
+	auto id = definition.id;
+	definitions[id] = std::make_shared<const Definition>(std::move(definition));
+}
+
+std::shared_ptr<const Definition> Library::find(std::string_view id) const noexcept {
+	if (auto it = definitions.find(std::string(id)); it != definitions.end()) {
+		return it->second;
+	}
+	return nullptr;
+}
+
+bool Library::inlinable(const Definition& definition) const {
+	return Counter().count(*definition.body) <= limit;
+}
@@ -1,8 +1,63 @@
 #include "expression.hpp"
+#include "chebyshev.hpp"
+#include "memoized.hpp"
+#include "ensemble.hpp"
+#include "server.hpp"
+#include "client.hpp"
 
 #include <iostream>
+#include <vector>
+#include <complex>
+#include <tuple>
+#include <ranges>
+#include <thread>
+#include <cstdint>
+#include <string>
+#include <csignal>
+
+namespace {
+
+Server* active = nullptr;
+
+// any client can compile into the shared cache, so what it may make the server hold and run per row is bounded
+constexpr Limits serve_limits{.nodes = 4096, .depth = 256, .cycles = 100000., .scratch = std::size_t(1) << 20};
+
+// program serve <socket> | program load <socket> [connections] [requests] [rows]
+int command(int argc, char* argv[]) {
+	std::string mode = argv[1];
+	if (mode == "serve") {
+		Server server(argv[2], 1024, serve_limits);
+		active = &server;
+		std::signal(SIGINT, [](int) { active->stop(); });
+		std::signal(SIGTERM, [](int) { active->stop(); });
+		server.serve();
+		auto stats = server.stats();
+		std::cout << stats.requests << " requests, " << stats.rows << " rows in " << stats.batches << " batches, "
+			<< stats.cached << " expressions cached" << std::endl;
+		return 0;
+	}
+	if (mode == "load") {
+		auto connections = argc > 3 ? std::stoul(argv[3]) : 8;
+		auto requests = argc > 4 ? std::stoul(argv[4]) : 2000;
+		auto rows = argc > 5 ? std::stoul(argv[5]) : 16;
+		auto report = load(argv[2], {"sin(x) * cos(y) + sqrt(x * x + y * y)", "x < y ? exp(-x) : log(1 + y)"}, connections, requests, rows);
+		std::cout << report.requests << " requests, " << report.rows << " rows in " << report.seconds << " s: "
+			<< report.throughput() << " requests/s, p50 " << report.p50 * 1e6 << " us, p99 " << report.p99 * 1e6 << " us, "
+			<< static_cast<double>(report.server.rows) / static_cast<double>(std::max<std::uint64_t>(report.server.batches, 1))
+			<< " rows per server batch" << std::endl;
+		return 0;
+	}
+	std::cerr << "usage: program [serve <socket> | load <socket> [connections] [requests] [rows]]" << std::endl;
+	return 1;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	if (argc >= 3) {
+		return command(argc, argv);
+	}
 
-int main() {
 	Expression expr("x+2 * f(x, y)");
 	expr.print();
 	
@@ -19,5 +74,170 @@ int main() {
 
 	std::cout << expr.eval(values, functions) << std::endl;
 
+	Expression surface("sin(x)*cos(y) - 0.9");
+	auto culling = surface.cull({{"x", {-4, 4}}, {"y", {-4, 4}}}, Interval::point(0), 10);
+	std::cout << culling.regions.size() << " regions kept, "
+		<< static_cast<std::size_t>(culling.culled_fraction * 1024 * 1024) << " of 1048576 point evaluations culled with "
+		<< culling.bounded << " bounds" << std::endl;
+
+	std::vector<float> xs(1000), ys(1000), zs(1000);
+	for (std::size_t i = 0; i < xs.size(); ++i) {
+		xs[i] = -4.f + 8.f * i / xs.size();
+		ys[i] = 4.f - 8.f * i / ys.size();
+	}
+	surface.eval<float>({{"x", xs}, {"y", ys}}, {}, zs);
+	std::cout << zs.front() << " ... " << zs.back() << std::endl;
+
+	Expression euler("exp(i*pi) + 1");
+	std::cout << euler.eval<std::complex<double>>({{"i", {0., 1.}}}, {}) << std::endl;
+
+	Expression wave("exp(-x/4) * sin(3*x)", Accuracy::approximate);
+	std::cout << wave.eval<double>({{"x", 1.5}}, {}) << std::endl;
+
+	// exact keeps the polynomial as written; fast may reassociate it into fma steps
+	for (auto accuracy : {Accuracy::exact, Accuracy::fast}) {
+		std::cout << Expression("x^3 - 2*x^2 + x - x + 5", accuracy).to_string() << " | "
+			<< Expression("x^3 - 2*x^2 + 5", accuracy).to_string() << std::endl;
+	}
+
+	Expression ripple("let r = sqrt(x^2 + y^2) in r * sin(r) / r");
+	std::cout << ripple.to_string() << " = " << ripple.eval(values, functions) << std::endl;
+
+	Library library;
+	library.define("f(a, b) = a + 2*b");
+	library.define("norm(a, b) = sqrt(a^2 + b^2)");
+	Expression defined("x + 2 * f(x, y) - norm(x, y)", library);
+	std::cout << defined.to_string() << " = " << defined.eval<double>(values, {}) << std::endl;
+
+	std::vector<std::tuple<double, double>> rows;
+	for (std::size_t i = 0; i < 1000; ++i) {
+		rows.emplace_back(xs[i], ys[i]);
+	}
+	for (double z : surface.stream<double>({"x", "y"}, rows) | std::views::filter([](double z) { return z > -0.5; }) | std::views::take(3)) {
+		std::cout << z << " ";
+	}
+	std::cout << std::endl;
+
+	auto program = ripple.compile<double>();
+	auto x = program.index("x"), y = program.index("y");
+	std::vector<double> sums(4);
+	std::vector<std::thread> workers;
+	for (std::size_t t = 0; t < sums.size(); ++t) {
+		workers.emplace_back([&program, &sums, x, y, t] {
+			Context<double> context(program);
+			double row[2];
+			row[x] = static_cast<double>(t);
+			for (std::size_t i = 0; i < 100000; ++i) {
+				row[y] = 1. + i * 1e-4;
+				sums[t] += program.run(context, row);
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	std::cout << sums[0] << " " << sums[1] << " " << sums[2] << " " << sums[3] << std::endl;
+
+	if (auto bound = Expression("sqrt(x) / y").bind<double>()) {
+		std::vector<double> xs = {4., -1., 1.}, ys = {2., 1., 0.}, out(3);
+		std::vector<std::uint8_t> faults(3);
+		Context<double> context(*bound);
+		if (bound->run(context, {{"x", xs}, {"y", ys}}, out, faults)) {
+			for (std::size_t i = 0; i < out.size(); ++i) {
+				std::cout << out[i] << " (" << static_cast<int>(faults[i]) << ") ";
+			}
+			std::cout << std::endl;
+		}
+	}
+	if (auto broken = Expression::parse("max(x)"); !broken) {
+		std::cout << broken.error() << std::endl;
+	}
+
+	auto cost = Expression("let r = sqrt(x * x + y * y) in r > 1 ? exp(-r) : pow(r, 3) / 2").analyze();
+	std::cout << cost.nodes << " nodes, depth " << cost.depth << ", " << cost.cycles << " cycles, "
+		<< cost.scratch<double>() << " bytes:";
+	for (auto& [op, uses] : cost.operators) {
+		std::cout << " " << op << ":" << uses;
+	}
+	std::cout << std::endl;
+	if (auto nested = Expression::parse(std::string(100000, '(') + "x", Library(), Accuracy::exact, {.depth = 64}); !nested) {
+		std::cout << nested.error() << std::endl;
+	}
+
+	Expression calibrated("a0 + a1 * x + a2 * x^2 + g * exp(-k * t)");
+	auto specialized = calibrated.specialize({{"a0", 0.5}, {"a1", -1.25}, {"a2", 0.75}, {"g", 2.}, {"k", 0.3}});
+	std::cout << specialized.to_string() << " = " << specialized.eval<double>({{"x", 2.}, {"t", 1.}}, {}) << std::endl;
+	auto rescaled = specialized.substitute("t", Expression("x / 2"));
+	std::cout << rescaled.to_string() << " = " << rescaled.eval<double>({{"x", 2.}}, {}) << std::endl;
+
+	Memoized<double> settle([](const std::vector<double>& args) {
+		double x = 1.;
+		for (int i = 0; i < 100; ++i) {
+			x -= (x * x * x - args[0]) / (3. * x * x);
+		}
+		return x;
+	}, 256);
+	Functions<double> solvers = {{"settle", settle}};
+	Expression roots("settle(n) + settle(n + 1)");
+	double settled = 0.;
+	for (int i = 0; i < 1000; ++i) {
+		settled += roots.eval<double>({{"n", static_cast<double>(i % 10)}}, solvers);
+	}
+	std::cout << settled << " " << settle.stats().hits << " hits, " << settle.stats().misses << " misses" << std::endl;
+
+	std::vector<double> axis = {-1., -0.5, 0., 0.5, 1.}, heat(axis.size() * axis.size());
+	Expression("exp(-y * y) * cos(x) + y").grid<double>("x", axis, "y", axis, heat, {}, {}, 2);
+	std::cout << heat.front() << " " << heat[heat.size() / 2] << " " << heat.back() << std::endl;
+
+	std::vector<double> samples(100000);
+	for (std::size_t i = 0; i < samples.size(); ++i) {
+		samples[i] = i * 1e-4;
+	}
+	auto summary = Expression("sin(x) * x").reduce<double>({{"x", samples}}, {}, 2);
+	auto spread = Expression("sin(x)").histogram({{"x", samples}}, -1., 1., 4);
+	std::cout << summary.mean() << " [" << summary.min << ", " << summary.max << "] "
+		<< spread.bins[0] << " " << spread.bins[1] << " " << spread.bins[2] << " " << spread.bins[3] << std::endl;
+
+	// the 1 survives the cancellation only through the compensation
+	std::vector<double> cancelling = {1e16, 1., -1e16};
+	std::cout << Expression("x").reduce<double>({{"x", cancelling}}).sum << std::endl;
+
+	Chebyshev damped(Expression("sin(x) * exp(-x / 4)"), "x", {0., 10.}, 1e-10);
+	std::cout << damped(2.5) << " " << damped.pieces() << " pieces, error " << damped.error() << std::endl;
+
+	Expression hot("x * x - y / 2");
+	hot.tiering({100});
+	double warmed = 0.;
+	for (int i = 0; i < 1000; ++i) {
+		warmed += hot.eval<double>({{"x", i * 1e-3}, {"y", 4.}}, {});
+	}
+	auto tier = hot.tier_stats<double>();
+	std::cout << warmed << (tier.tier == Tier::compiled ? " compiled" : " still walked") << " after about " << tier.interpreted
+		<< " tree walks" << std::endl;
+
+	std::vector<Expression> rules;
+	rules.emplace_back("x * y > 10 ? x : y");
+	rules.emplace_back("sqrt(x^2 + y^2) - x * y");
+	rules.emplace_back("norm(x, y) / (y * x)", library);
+	Ensemble<double> ensemble(rules);
+	std::vector<double> verdicts(ensemble.size());
+	ensemble.eval(values, verdicts);
+	std::cout << verdicts[0] << " " << verdicts[1] << " " << verdicts[2] << " in " << ensemble.cells() << " cells" << std::endl;
+
+#ifdef PROFILING
+	Profile profile;
+	expr.profile(values, functions, profile);
+	std::cout << profile.annotate() << std::endl;
+	std::cout << profile.to_json() << std::endl;
+#endif
+
+#ifdef METRICS
+	auto metrics = Metrics::snapshot();
+	std::cout << metrics.counter(Metric::expressions) << " expressions, " << metrics.counter(Metric::nodes) << " nodes, "
+		<< metrics.counter(Metric::allocations) << " allocations, eval p99 "
+		<< metrics.phase(Phase::eval).percentile(0.99) << " ns" << std::endl;
+	std::cout << metrics.to_prometheus();
+#endif
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "memoized.hpp"
+
+#include "visitor.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <complex>
+
+template <typename T>
+struct Memoized<T>::Cache {
+	using Entries = std::list<std::pair<std::string, T>>;
+
+	Function<T> func;
+	std::size_t capacity;
+
+	std::mutex mutex;
+	Entries entries;
+	std::unordered_map<std::string_view, typename Entries::iterator> index;
+	CacheStats stats;
+};
+
+template <typename T>
+Memoized<T>::Memoized(Function<T> func, std::size_t capacity) : cache(std::make_shared<Cache>()) {
+	cache->func = std::move(func);
+	cache->capacity = capacity;
+}
+
+template <typename T>
+T Memoized<T>::operator()(const std::vector<T>& args) const {
+
+	std::string_view key(reinterpret_cast<const char*>(args.data()), args.size() * sizeof(T));
+	{
+		std::scoped_lock lock(cache->mutex);
+		if (auto it = cache->index.find(key); it != cache->index.end()) {
+			++cache->stats.hits;
+			cache->entries.splice(cache->entries.begin(), cache->entries, it->second);
+			return it->second->second;
+		}
+		++cache->stats.misses;
+	}
+
+	auto value = cache->func(args);
+
+	std::scoped_lock lock(cache->mutex);
+	if (cache->capacity == 0 || cache->index.contains(key)) {
+		return value;
+	}
+	cache->entries.emplace_front(std::string(key), value);
+	cache->index.emplace(cache->entries.front().first, cache->entries.begin());
+	if (cache->entries.size() > cache->capacity) {
+		cache->index.erase(cache->entries.back().first);
+		cache->entries.pop_back();
+		++cache->stats.evictions;
+	}
+	return value;
+}
+
+template <typename T>
+CacheStats Memoized<T>::stats() const {
+	std::scoped_lock lock(cache->mutex);
+	return cache->stats;
+}
+
+template <typename T>
+void Memoized<T>::clear() const {
+	std::scoped_lock lock(cache->mutex);
+	cache->index.clear();
+	cache->entries.clear();
+	cache->stats = {};
+}
+
+template class Memoized<float>;
+template class Memoized<double>;
+template class Memoized<std::complex<double>>;
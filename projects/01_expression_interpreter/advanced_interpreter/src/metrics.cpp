@@ -0,0 +1,175 @@
+#include "metrics.hpp"
+
+#ifdef METRICS
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace {
+
+constexpr std::size_t sub_bits = 3;
+constexpr std::size_t sub_buckets = std::size_t(1) << sub_bits;
+constexpr std::size_t buckets = (64 - sub_bits + 1) * sub_buckets;
+
+constexpr std::array<std::string_view, 5> phase_names = {"lex", "parse", "optimize", "bind", "eval"};
+constexpr std::array<std::string_view, 4> metric_names = {"expressions", "nodes", "allocations", "promotions"};
+constexpr std::array<std::pair<double, std::string_view>, 5> quantiles = {{{0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}, {1., "1"}}};
+
+// values below 2^sub_bits are exact; above, each power of two is split into sub_buckets linear steps
+constexpr std::size_t bucket(std::uint64_t value) noexcept {
+	if (value < sub_buckets) {
+		return static_cast<std::size_t>(value);
+	}
+	auto shift = static_cast<std::size_t>(std::bit_width(value)) - 1 - sub_bits;
+	return ((shift + 1) << sub_bits) + static_cast<std::size_t>((value >> shift) & (sub_buckets - 1));
+}
+
+constexpr std::uint64_t upper_bound(std::size_t index) noexcept {
+	if (index < sub_buckets) {
+		return index;
+	}
+	auto shift = (index >> sub_bits) - 1;
+	auto lower = static_cast<std::uint64_t>(sub_buckets + (index & (sub_buckets - 1))) << shift;
+	return lower + ((std::uint64_t(1) << shift) - 1);
+}
+
+static_assert(bucket(7) == 7 && bucket(8) == 8 && bucket(15) == 15 && bucket(16) == 16 && bucket(17) == 16 && bucket(18) == 17);
+static_assert(upper_bound(16) == 17 && upper_bound(bucket(~std::uint64_t(0))) == ~std::uint64_t(0));
+
+struct Recorder {
+	std::array<std::atomic<std::uint64_t>, buckets> hits{};
+	std::atomic<std::uint64_t> count{0}, total{0}, max{0};
+};
+
+// constant-initialized, so recording is safe even from other translation units' static constructors
+constinit std::array<Recorder, 5> recorders{};
+constinit std::array<std::atomic<std::uint64_t>, 4> counters{};
+
+std::string phase_label(std::string_view name) {
+	return "phase=\"" + std::string(name) + "\"";
+}
+
+}
+
+void Metrics::record(Phase phase, std::chrono::nanoseconds elapsed) noexcept {
+	auto& recorder = recorders[static_cast<std::size_t>(phase)];
+	auto value = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(elapsed.count(), 0));
+
+	recorder.hits[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+	recorder.count.fetch_add(1, std::memory_order_relaxed);
+	recorder.total.fetch_add(value, std::memory_order_relaxed);
+	auto max = recorder.max.load(std::memory_order_relaxed);
+	while (value > max && !recorder.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+void Metrics::count(Metric metric, std::uint64_t n) noexcept {
+	counters[static_cast<std::size_t>(metric)].fetch_add(n, std::memory_order_relaxed);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+	MetricsSnapshot snapshot;
+	for (std::size_t i = 0; i < recorders.size(); ++i) {
+		auto& stats = snapshot.phases[i];
+		stats.count = recorders[i].count.load(std::memory_order_relaxed);
+		stats.total = recorders[i].total.load(std::memory_order_relaxed);
+		stats.max = recorders[i].max.load(std::memory_order_relaxed);
+		for (std::size_t j = 0; j < buckets; ++j) {
+			if (auto hits = recorders[i].hits[j].load(std::memory_order_relaxed)) {
+				stats.buckets.emplace_back(upper_bound(j), hits);
+			}
+		}
+	}
+	for (std::size_t i = 0; i < counters.size(); ++i) {
+		snapshot.counters[i] = counters[i].load(std::memory_order_relaxed);
+	}
+	return snapshot;
+}
+
+void Metrics::reset() noexcept {
+	for (auto& recorder : recorders) {
+		for (auto& hits : recorder.hits) {
+			hits.store(0, std::memory_order_relaxed);
+		}
+		recorder.count.store(0, std::memory_order_relaxed);
+		recorder.total.store(0, std::memory_order_relaxed);
+		recorder.max.store(0, std::memory_order_relaxed);
+	}
+	for (auto& counter : counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+std::uint64_t PhaseStats::percentile(double q) const noexcept {
+	std::uint64_t seen = 0;
+	auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count));
+	for (auto [bound, hits] : buckets) {
+		seen += hits;
+		if (seen > rank || seen == count) {
+			return std::min(bound, max);
+		}
+	}
+	return 0;
+}
+
+std::string MetricsSnapshot::to_json() const {
+	std::string json = "{\"phases\": {";
+	for (std::size_t i = 0; i < phases.size(); ++i) {
+		auto& stats = phases[i];
+		json += (i ? ", \"" : "\"") + std::string(phase_names[i]) + "\": {\"count\": " + std::to_string(stats.count)
+			+ ", \"total_ns\": " + std::to_string(stats.total)
+			+ ", \"max_ns\": " + std::to_string(stats.max)
+			+ ", \"p50_ns\": " + std::to_string(stats.percentile(0.5))
+			+ ", \"p99_ns\": " + std::to_string(stats.percentile(0.99))
+			+ ", \"p999_ns\": " + std::to_string(stats.percentile(0.999))
+			+ ", \"buckets\": [";
+		for (std::size_t j = 0; j < stats.buckets.size(); ++j) {
+			json += (j ? ", [" : "[") + std::to_string(stats.buckets[j].first) + ", " + std::to_string(stats.buckets[j].second) + "]";
+		}
+		json += "]}";
+	}
+	json += "}, \"counters\": {";
+	for (std::size_t i = 0; i < counters.size(); ++i) {
+		json += (i ? ", \"" : "\"") + std::string(metric_names[i]) + "\": " + std::to_string(counters[i]);
+	}
+	return json + "}}";
+}
+
+std::string MetricsSnapshot::to_prometheus() const {
+	std::string text = "# TYPE expression_phase_seconds summary\n";
+	for (std::size_t i = 0; i < phases.size(); ++i) {
+		auto& stats = phases[i];
+		auto label = phase_label(phase_names[i]);
+		for (auto [q, name] : quantiles) {
+			text += "expression_phase_seconds{" + label + ",quantile=\"" + std::string(name) + "\"} "
+				+ std::to_string(static_cast<double>(stats.percentile(q)) * 1e-9) + "\n";
+		}
+		text += "expression_phase_seconds_sum{" + label + "} " + std::to_string(static_cast<double>(stats.total) * 1e-9) + "\n";
+		text += "expression_phase_seconds_count{" + label + "} " + std::to_string(stats.count) + "\n";
+	}
+	for (std::size_t i = 0; i < counters.size(); ++i) {
+		auto name = "expression_" + std::string(metric_names[i]) + "_total";
+		text += "# TYPE " + name + " counter\n" + name + " " + std::to_string(counters[i]) + "\n";
+	}
+	return text;
+}
+
+void MetricsSnapshot::write(const std::string& path, MetricsFormat format) const {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Cannot open file: " + path);
+	}
+	file << (format == MetricsFormat::json ? to_json() + "\n" : to_prometheus());
+	if (!file) {
+		throw std::runtime_error("Cannot write file: " + path);
+	}
+}
+
+#endif
@@ -0,0 +1,273 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr unsigned long max_exponent = 32;
+constexpr unsigned long max_chain = 8;
+
+std::optional<double> constant(const ASTNode& node) {
+	if (auto num = dynamic_cast<const NumNode*>(&node)) {
+		return num->value;
+	}
+	if (auto group = dynamic_cast<const GroupNode*>(&node)) {
+		return constant(*group->base);
+	}
+	if (auto unary = dynamic_cast<const UnaryNode*>(&node)) {
+		if (auto value = constant(*unary->base)) {
+			return unary->op == "-" ? -*value : *value;
+		}
+	}
+	return std::nullopt;
+}
+
+std::optional<unsigned long> exponent(const ASTNode& node) {
+	if (auto value = constant(node); value && *value >= 0 && *value <= max_exponent && std::trunc(*value) == *value) {
+		return static_cast<unsigned long>(*value);
+	}
+	return std::nullopt;
+}
+
+bool same(const ASTNode& a, const ASTNode& b) {
+	auto x = dynamic_cast<const VarNode*>(&a);
+	auto y = dynamic_cast<const VarNode*>(&b);
+	return x && y && x->id == y->id && x->slot == y->slot;
+}
+
+bool leaf(const ASTNode& node) {
+	return dynamic_cast<const VarNode*>(&node) || dynamic_cast<const NumNode*>(&node);
+}
+
+// proves the value is NaN or in [+0, +inf], where pow(x, 0.5) and sqrt(x) agree on every special value
+bool nonnegative(const ASTNode& node) {
+	if (auto num = dynamic_cast<const NumNode*>(&node)) {
+		return !std::signbit(num->value);
+	}
+	if (auto group = dynamic_cast<const GroupNode*>(&node)) {
+		return nonnegative(*group->base);
+	}
+	if (auto let = dynamic_cast<const LetNode*>(&node)) {
+		return nonnegative(*let->body);
+	}
+	if (auto cond = dynamic_cast<const CondNode*>(&node)) {
+		return nonnegative(*cond->on_true) && nonnegative(*cond->on_false);
+	}
+	if (auto binary = dynamic_cast<const BinaryNode*>(&node)) {
+		if (binary->op == "*") {
+			return same(*binary->left, *binary->right) || (nonnegative(*binary->left) && nonnegative(*binary->right));
+		}
+		if (binary->op == "+" || binary->op == "/") {
+			return nonnegative(*binary->left) && nonnegative(*binary->right);
+		}
+		if (binary->op == "^") {
+			auto n = exponent(*binary->right);
+			return (n && *n % 2 == 0) || nonnegative(*binary->left);
+		}
+	}
+	if (auto func = dynamic_cast<const FuncNode*>(&node); func && !func->definition) {
+		if (func->id == "exp" || func->id == "abs") {
+			return func->args.size() == 1;
+		}
+		if (func->id == "sqrt") {
+			return func->args.size() == 1 && nonnegative(*func->args[0]);
+		}
+	}
+	return false;
+}
+
+using Polynomial = std::map<unsigned long, double>;
+
+std::optional<std::pair<double, unsigned long>> monomial(const ASTNode& node, const VarNode*& var) {
+	if (auto value = constant(node)) {
+		return std::pair(*value, 0ul);
+	}
+	if (auto group = dynamic_cast<const GroupNode*>(&node)) {
+		return monomial(*group->base, var);
+	}
+	if (auto unary = dynamic_cast<const UnaryNode*>(&node)) {
+		auto term = monomial(*unary->base, var);
+		if (term && unary->op == "-") {
+			term->first = -term->first;
+		}
+		return term;
+	}
+	if (auto base = dynamic_cast<const VarNode*>(&node)) {
+		if (!var) {
+			var = base;
+		}
+		return same(*var, *base) ? std::optional(std::pair(1., 1ul)) : std::nullopt;
+	}
+	if (auto binary = dynamic_cast<const BinaryNode*>(&node)) {
+		if (binary->op == "^") {
+			auto n = exponent(*binary->right);
+			auto term = n ? monomial(*binary->left, var) : std::nullopt;
+			if (term && term->first == 1. && term->second == 1) {
+				return std::pair(1., *n);
+			}
+		} else if (binary->op == "*") {
+			auto left = monomial(*binary->left, var);
+			auto right = left ? monomial(*binary->right, var) : std::nullopt;
+			if (right && left->second + right->second <= max_exponent) {
+				return std::pair(left->first * right->first, left->second + right->second);
+			}
+		} else if (binary->op == "/") {
+			auto left = monomial(*binary->left, var);
+			auto right = constant(*binary->right);
+			if (left && right) {
+				return std::pair(left->first / *right, left->second);
+			}
+		}
+	}
+	return std::nullopt;
+}
+
+bool collect(const ASTNode& node, double sign, Polynomial& polynomial, std::size_t& terms, const VarNode*& var) {
+	if (auto group = dynamic_cast<const GroupNode*>(&node)) {
+		return collect(*group->base, sign, polynomial, terms, var);
+	}
+	if (auto binary = dynamic_cast<const BinaryNode*>(&node); binary && (binary->op == "+" || binary->op == "-")) {
+		return collect(*binary->left, sign, polynomial, terms, var)
+			&& collect(*binary->right, binary->op == "-" ? -sign : sign, polynomial, terms, var);
+	}
+	auto term = monomial(node, var);
+	if (!term) {
+		return false;
+	}
+	polynomial[term->second] += sign * term->first;
+	++terms;
+	return true;
+}
+
+}
+
+void Optimizer::optimize(Node& node) {
+	rewrite(node);
+}
+
+void Optimizer::visit(const BinaryNode& node) {
+
+	if (accuracy == Accuracy::exact) {
+		Rewriter::visit(node);
+		return;
+	}
+
+	std::size_t terms = 0;
+	auto polynomial = node.op == "+" || node.op == "-" ? horner(node, terms) : nullptr;
+	if (polynomial && terms > 2) {
+		replacement = std::move(polynomial);
+		return;
+	}
+
+	auto left = node.left, right = node.right;
+	optimize(left);
+	optimize(right);
+
+	auto value = node.op == "^" ? constant(*right) : std::nullopt;
+	auto n = value ? std::abs(*value) : 0.;
+	if (value && *value == 0.5 && nonnegative(*left)) {
+		std::vector<Node> args;
+		args.push_back(std::move(left));
+		replacement = std::make_shared<FuncNode>("sqrt", std::move(args));
+	} else if (n >= 1 && n <= max_chain && std::trunc(n) == n) {
+		auto chain = power(std::move(left), static_cast<unsigned long>(n));
+		if (*value < 0) {
+			chain = std::make_shared<BinaryNode>("/", std::make_shared<NumNode>(1.), leaf(*chain) ? std::move(chain) : std::make_shared<GroupNode>(std::move(chain)));
+		}
+		replacement = std::move(chain);
+	} else if (left != node.left || right != node.right) {
+		replacement = std::make_shared<BinaryNode>(node.op, std::move(left), std::move(right));
+	}
+
+	// two terms are already cheap as power chains, so Horner form has to beat them
+	if (polynomial) {
+		Counter counter;
+		if (counter.count(*polynomial) < counter.count(replacement ? *replacement : node)) {
+			replacement = std::move(polynomial);
+		}
+	}
+}
+
+// the factors of the chain are one shared subtree, not copies of it
+Node Optimizer::power(Node base, unsigned long n) {
+	std::vector<Binding> bindings;
+	auto bind = [&](Node value) -> Node {
+		auto slot = depth + bindings.size();
+		bindings.emplace_back("_pow", slot, std::move(value));
+		return std::make_shared<VarNode>("_pow", slot);
+	};
+
+	auto square = leaf(*base) || n == 1 ? std::move(base) : bind(std::move(base));
+	Node product;
+	while (true) {
+		if (n & 1) {
+			product = product ? std::make_shared<BinaryNode>("*", std::move(product), square) : square;
+		}
+		if (!(n >>= 1)) {
+			break;
+		}
+		Node next = std::make_shared<BinaryNode>("*", square, square);
+		square = n == 1 ? std::move(next) : bind(std::move(next));
+	}
+
+	if (bindings.empty()) {
+		return product;
+	}
+	return std::make_shared<GroupNode>(std::make_shared<LetNode>(std::move(bindings), std::move(product)));
+}
+
+Node Optimizer::horner(const BinaryNode& node, std::size_t& terms) {
+	Polynomial polynomial;
+	const VarNode* var = nullptr;
+	if (!collect(node, 1., polynomial, terms, var) || !var || terms < 2) {
+		return nullptr;
+	}
+	// x - x is NaN at an infinite x, so a sum whose x terms cancel keeps its form; cancelled constants are finite
+	if (std::ranges::any_of(polynomial, [](const auto& term) { return term.first > 0 && term.second == 0.; })) {
+		return nullptr;
+	}
+	if (auto it = polynomial.find(0); it != polynomial.end() && it->second == 0.) {
+		polynomial.erase(it);
+	}
+	if (polynomial.empty() || polynomial.rbegin()->first < 2) {
+		return nullptr;
+	}
+
+	auto degree = polynomial.rbegin()->first;
+	Node x = std::make_shared<VarNode>(var->id, var->slot);
+	Node acc;
+	auto k = degree;
+	// a unit leading coefficient starts from x itself, and its first step is a plain add
+	if (polynomial[degree] == 1.) {
+		acc = x;
+		if (auto it = polynomial.find(--k); it != polynomial.end()) {
+			auto c = std::make_shared<NumNode>(std::abs(it->second));
+			acc = std::make_shared<BinaryNode>(it->second < 0 ? "-" : "+", std::move(acc), std::move(c));
+		}
+	} else {
+		acc = std::make_shared<NumNode>(polynomial[degree]);
+	}
+	while (k-- > 0) {
+		if (auto it = polynomial.find(k); it != polynomial.end()) {
+			std::vector<Node> args;
+			args.push_back(std::move(acc));
+			args.push_back(x);
+			args.push_back(std::make_shared<NumNode>(it->second));
+			acc = std::make_shared<FuncNode>("fma", std::move(args));
+		} else {
+			auto sum = dynamic_cast<const BinaryNode*>(acc.get());
+			auto group = sum && sum->op != "*";
+			acc = std::make_shared<BinaryNode>("*", group ? std::make_shared<GroupNode>(std::move(acc)) : std::move(acc), x);
+		}
+	}
+	return acc;
+}
@@ -1,6 +1,8 @@
 #include "parser.hpp"
 
 #include "token.hpp"
+#include "lexer.hpp"
+#include "metrics.hpp"
 #include "ast.hpp"
 
 #include <string>
@@ -9,54 +11,199 @@
 #include <memory>
 #include <utility>
 #include <stdexcept>
+#include <algorithm>
+#include <ranges>
 
-std::unique_ptr<ASTNode> Parser::parse() {
-	return parse_sum();
+Node Parser::parse() {
+	Stopwatch watch;
+	auto root = parse_expr();
+	finish(watch);
+	return root;
 }
 
-std::unique_ptr<ASTNode> Parser::parse_sum() {
+Node Parser::parse_expr() {
+	if (match(TokenType::LET)) {
+		return parse_let();
+	}
+	return parse_cond();
+}
+
+Definition Parser::parse_definition() {
+	Stopwatch watch;
+	consume(TokenType::ID, "Expected identifier, got " + std::string(current().value));
+	auto id = previous().value;
+	consume(TokenType::LPAREN, "Expected (, got " + std::string(current().value));
+
+	std::vector<std::string> params;
+	if (!match(TokenType::RPAREN)) {
+		do {
+			consume(TokenType::ID, "Expected identifier, got " + std::string(current().value));
+			auto param = previous().value;
+			if (std::ranges::find(scope, param) != scope.end()) {
+				report("Duplicate parameter: " + std::string(param));
+			}
+			params.emplace_back(param);
+			scope.push_back(param);
+		} while (match(TokenType::COMMA));
+		consume(TokenType::RPAREN, "Expected ), got " + std::string(current().value));
+	}
+
+	consume(TokenType::ASSIGN, "Expected =, got " + std::string(current().value));
+	auto body = parse_expr();
+	finish(watch);
+	scope.clear();
+
+	return Definition{std::string(id), std::move(params), std::move(body)};
+}
+
+Node Parser::parse_let() {
+	auto depth = scope.size();
+
+	std::vector<Binding> bindings;
+	do {
+		consume(TokenType::ID, "Expected identifier, got " + std::string(current().value));
+		auto id = previous().value;
+		consume(TokenType::ASSIGN, "Expected =, got " + std::string(current().value));
+		descend();
+		auto value = parse_expr();
+		--nesting;
+		bindings.emplace_back(id, scope.size(), std::move(value));
+		scope.push_back(id);
+	} while (match(TokenType::SEMICOLON));
+
+	consume(TokenType::IN, "Expected in, got " + std::string(current().value));
+	descend();
+	auto body = parse_expr();
+	--nesting;
+	scope.resize(depth);
+
+	return std::make_shared<LetNode>(std::move(bindings), std::move(body));
+}
+
+Node Parser::parse_cond() {
+	auto cond = parse_or();
+	if (match(TokenType::QUESTION)) {
+		descend();
+		auto on_true = parse_expr();
+		consume(TokenType::COLON, "Expected :, got " + std::string(current().value));
+		auto on_false = parse_cond();
+		--nesting;
+		return std::make_shared<CondNode>(std::move(cond), std::move(on_true), std::move(on_false));
+	}
+	return cond;
+}
+
+Node Parser::parse_or() {
+	auto left = parse_and();
+	std::size_t chain = 0;
+	while (match(TokenType::OR)) {
+		auto op = previous().value;
+		lengthen(chain);
+		descend();
+		auto right = parse_and();
+		--nesting;
+		left = std::make_shared<LogicalNode>(op, std::move(left), std::move(right));
+	}
+	return left;
+}
+
+Node Parser::parse_and() {
+	auto left = parse_equality();
+	std::size_t chain = 0;
+	while (match(TokenType::AND)) {
+		auto op = previous().value;
+		lengthen(chain);
+		descend();
+		auto right = parse_equality();
+		--nesting;
+		left = std::make_shared<LogicalNode>(op, std::move(left), std::move(right));
+	}
+	return left;
+}
+
+Node Parser::parse_equality() {
+	auto left = parse_relational();
+	std::size_t chain = 0;
+	while (match(TokenType::EQ, TokenType::NE)) {
+		auto op = previous().value;
+		lengthen(chain);
+		descend();
+		auto right = parse_relational();
+		--nesting;
+		left = std::make_shared<BinaryNode>(op, std::move(left), std::move(right));
+	}
+	return left;
+}
+
+Node Parser::parse_relational() {
+	auto left = parse_sum();
+	std::size_t chain = 0;
+	while (match(TokenType::LT, TokenType::LE, TokenType::GT, TokenType::GE)) {
+		auto op = previous().value;
+		lengthen(chain);
+		descend();
+		auto right = parse_sum();
+		--nesting;
+		left = std::make_shared<BinaryNode>(op, std::move(left), std::move(right));
+	}
+	return left;
+}
+
+Node Parser::parse_sum() {
 	auto left = parse_mul();
+	std::size_t chain = 0;
 	while (match(TokenType::PLUS, TokenType::MINUS)) {
 		auto op = previous().value;
+		lengthen(chain);
+		descend();
 		auto right = parse_mul();
-		left = std::make_unique<BinaryNode>(op, std::move(left), std::move(right));
+		--nesting;
+		left = std::make_shared<BinaryNode>(op, std::move(left), std::move(right));
 	}
 	return left;
 }
 
-std::unique_ptr<ASTNode> Parser::parse_mul() {
+Node Parser::parse_mul() {
 	auto left = parse_pow();
+	std::size_t chain = 0;
 	while (match(TokenType::STAR, TokenType::SLASH)) {
 		auto op = previous().value;
+		lengthen(chain);
+		descend();
 		auto right = parse_pow();
-		left = std::make_unique<BinaryNode>(op, std::move(left), std::move(right));
+		--nesting;
+		left = std::make_shared<BinaryNode>(op, std::move(left), std::move(right));
 	}
 	return left;
 }
 
-std::unique_ptr<ASTNode> Parser::parse_pow() {
+Node Parser::parse_pow() {
 	auto left = parse_unary();
 	if (match(TokenType::CARET)) {
 		auto op = previous().value;
+		descend();
 		auto right = parse_pow();
-		left = std::make_unique<BinaryNode>(op, std::move(left), std::move(right));
+		--nesting;
+		left = std::make_shared<BinaryNode>(op, std::move(left), std::move(right));
 	}
 	return left;
 }
 
-std::unique_ptr<ASTNode> Parser::parse_unary() {
+Node Parser::parse_unary() {
 	if (match(TokenType::PLUS, TokenType::MINUS)) {
 		auto op = previous().value;
+		descend();
 		auto base = parse_unary();
-		return std::make_unique<UnaryNode>(op, std::move(base));
+		--nesting;
+		return std::make_shared<UnaryNode>(op, std::move(base));
 	}
 	return parse_primary();
 }
 
-std::unique_ptr<ASTNode> Parser::parse_primary() {
+Node Parser::parse_primary() {
 	if (match(TokenType::NUM)) {
 		auto value = previous().value;
-		return std::make_unique<NumNode>(value);
+		return std::make_shared<NumNode>(value);
 	}
 
 	if (match(TokenType::LPAREN)) {
@@ -70,44 +217,66 @@ std::unique_ptr<ASTNode> Parser::parse_primary() {
 	report("Unexpected token: " + std::string(current().value));
 }
 
-std::unique_ptr<ASTNode> Parser::parse_group() {
-	auto base = parse();
+Node Parser::parse_group() {
+	descend();
+	auto base = parse_expr();
+	--nesting;
 	consume(TokenType::RPAREN, "Expected ), got " + std::string(current().value));
-	return std::make_unique<GroupNode>(std::move(base));
+	return std::make_shared<GroupNode>(std::move(base));
 }
 
-std::unique_ptr<ASTNode> Parser::parse_func() {
+Node Parser::parse_func() {
 	auto id = previous().value;
 
 	if (match(TokenType::LPAREN)) {
-		std::vector<std::unique_ptr<ASTNode>> args;
+		std::vector<Node> args;
 		if (!match(TokenType::RPAREN)) {
+			descend();
 			do {
-				auto arg = parse();
+				auto arg = parse_expr();
 				args.push_back(std::move(arg));
 			} while (match(TokenType::COMMA));
+			--nesting;
 			consume(TokenType::RPAREN, "Expected ), got " + std::string(current().value));
 		}
-		return std::make_unique<FuncNode>(id, std::move(args));
+		return std::make_shared<FuncNode>(id, std::move(args));
+	}
+
+	if (auto it = std::ranges::find(scope | std::views::reverse, id); it != scope.rend()) {
+		return std::make_shared<VarNode>(id, static_cast<std::size_t>(std::distance(it, scope.rend()) - 1));
 	}
+	return std::make_shared<VarNode>(id);
+}
 
-	return std::make_unique<VarNode>(id);
+inline const Token& Parser::current() const noexcept {
+	return lexer.peek();
 }
 
-inline Token Parser::current() const noexcept {
-	return tokens[index];
+inline const Token& Parser::previous() const noexcept {
+	return last;
 }
 
-inline Token Parser::previous() const noexcept {
-	return tokens[index - 1];
+inline void Parser::advance() {
+	last = lexer.next();
 }
 
-inline void Parser::advance() noexcept {
-	++index;
+// called only where the node being parsed becomes the parent of what is parsed next,
+// so nesting counts the nodes above the next one and stays below the depth of the finished tree
+inline void Parser::descend() {
+	if (++nesting >= limit) {
+		report("Expression too deep");
+	}
+}
+
+// the k-th operator of a left-associative chain puts k nodes above its first operand, though nothing recursed
+inline void Parser::lengthen(std::size_t& chain) {
+	if (nesting + ++chain >= limit) {
+		report("Expression too deep");
+	}
 }
 
 template <typename... Args>
-inline bool Parser::match(Args... args) noexcept {
+inline bool Parser::match(Args... args) {
 	if (((current().type == args) || ...)) {
 		advance();
 		return true;
@@ -121,6 +290,12 @@ inline void Parser::consume(TokenType type, std::string_view message) {
 	}
 }
 
+void Parser::finish(const Stopwatch& watch) {
+	consume(TokenType::END, "Unexpected token: " + std::string(current().value));
+	Metrics::record(Phase::lex, lexer.elapsed());
+	Metrics::record(Phase::parse, watch.elapsed() - lexer.elapsed());
+}
+
 inline void Parser::report(std::string_view message) const {
 	throw std::runtime_error(std::string(message));
 }
@@ -4,29 +4,56 @@
 
 #include <iostream>
 
-void Printer::print(ASTNode& node) noexcept {
+void Printer::print(const ASTNode& node) noexcept {
 	node.accept(*this);
 	std::cout << std::endl;
 }
 
-void Printer::visit(BinaryNode& node) {
+void Printer::visit(const BinaryNode& node) {
 	node.left->accept(*this);
 	std::cout << node.op;
 	node.right->accept(*this);
 }
 
-void Printer::visit(UnaryNode& node) {
+void Printer::visit(const UnaryNode& node) {
 	std::cout << node.op;
 	node.base->accept(*this);
 }
 
-void Printer::visit(GroupNode& node) {
+void Printer::visit(const LogicalNode& node) {
+	node.left->accept(*this);
+	std::cout << node.op;
+	node.right->accept(*this);
+}
+
+void Printer::visit(const CondNode& node) {
+	node.cond->accept(*this);
+	std::cout << "?";
+	node.on_true->accept(*this);
+	std::cout << ":";
+	node.on_false->accept(*this);
+}
+
+void Printer::visit(const LetNode& node) {
+	std::cout << "let ";
+	for (std::size_t i = 0; i < node.bindings.size(); ++i) {
+		std::cout << node.bindings[i].id << " = ";
+		node.bindings[i].value->accept(*this);
+		if (i != node.bindings.size() - 1) {
+			std::cout << "; ";
+		}
+	}
+	std::cout << " in ";
+	node.body->accept(*this);
+}
+
+void Printer::visit(const GroupNode& node) {
 	std::cout << "(";
 	node.base->accept(*this);
 	std::cout << ")";
 }
 
-void Printer::visit(FuncNode& node) {
+void Printer::visit(const FuncNode& node) {
 	std::cout << node.id << "(";
 	for (std::size_t i = 0; i < node.args.size(); ++i) {
 		node.args[i]->accept(*this);
@@ -37,10 +64,10 @@ void Printer::visit(FuncNode& node) {
 	std::cout << ")";
 }
 
-void Printer::visit(VarNode& node) {
+void Printer::visit(const VarNode& node) {
 	std::cout << node.id;
 }
 
-void Printer::visit(NumNode& node) {
+void Printer::visit(const NumNode& node) {
 	std::cout << node.value;
 }
\ No newline at end of file
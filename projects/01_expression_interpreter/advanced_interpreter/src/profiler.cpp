@@ -0,0 +1,202 @@
+#include "profiler.hpp"
+
+#ifdef PROFILING
+
+#include "visitor.hpp"
+#include "ast.hpp"
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+std::string entry_to_json(const ProfileEntry& entry) {
+	return "{\"hits\": " + std::to_string(entry.hits)
+		+ ", \"total_ns\": " + std::to_string(entry.total.count())
+		+ ", \"self_ns\": " + std::to_string(entry.self.count()) + "}";
+}
+
+std::string table_to_json(const std::map<std::string, ProfileEntry, std::less<>>& table) {
+	std::string json = "{";
+	for (auto it = table.begin(); it != table.end(); ++it) {
+		if (it != table.begin()) {
+			json += ", ";
+		}
+		json += "\"" + it->first + "\": " + entry_to_json(it->second);
+	}
+	return json + "}";
+}
+
+}
+
+const ProfileEntry& Profile::node(const ASTNode& node) const {
+	static const ProfileEntry empty;
+	if (auto it = nodes.find(&node); it != nodes.end()) {
+		return it->second;
+	}
+	return empty;
+}
+
+std::string Profile::to_json() const {
+	std::string json = "{\"nodes\": [";
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		Stringifier stringifier;
+		json += "{\"expr\": \"" + stringifier.stringify(*order[i]) + "\", \"stats\": " + entry_to_json(nodes.at(order[i])) + "}";
+		if (i != order.size() - 1) {
+			json += ", ";
+		}
+	}
+	json += "], \"operators\": " + table_to_json(ops);
+	json += ", \"functions\": " + table_to_json(funcs);
+	return json + "}";
+}
+
+std::string Profile::annotate() const {
+	if (!root) {
+		throw std::runtime_error("Profile is empty");
+	}
+	ProfileStringifier stringifier(*this);
+	return stringifier.stringify(*root);
+}
+
+void Profile::reset() noexcept {
+	root = nullptr;
+	order.clear();
+	nodes.clear();
+	ops.clear();
+	funcs.clear();
+}
+
+double ProfilingEvaluator::evaluate(const ASTNode& node) {
+	profile.root = &node;
+	return Evaluator::evaluate(node);
+}
+
+template <typename Node>
+void ProfilingEvaluator::measure(Node& node, std::map<std::string, ProfileEntry, std::less<>>* table, std::string_view key) {
+	auto [it, inserted] = profile.nodes.try_emplace(&node);
+	if (inserted) {
+		profile.order.push_back(&node);
+	}
+
+	auto outer = children;
+	children = std::chrono::nanoseconds{0};
+
+	auto start = std::chrono::steady_clock::now();
+	Evaluator::visit(node);
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+	auto self = elapsed - children;
+	children = outer + elapsed;
+
+	auto& entry = it->second;
+	++entry.hits;
+	entry.total += elapsed;
+	entry.self += self;
+
+	if (table) {
+		auto agg = table->find(key);
+		if (agg == table->end()) {
+			agg = table->emplace(std::string(key), ProfileEntry{}).first;
+		}
+		++agg->second.hits;
+		agg->second.total += elapsed;
+		agg->second.self += self;
+	}
+}
+
+void ProfilingEvaluator::visit(const BinaryNode& node) {
+	measure(node, &profile.ops, node.op);
+}
+
+void ProfilingEvaluator::visit(const UnaryNode& node) {
+	measure(node, &profile.ops, "unary" + node.op);
+}
+
+void ProfilingEvaluator::visit(const LogicalNode& node) {
+	measure(node, &profile.ops, node.op);
+}
+
+void ProfilingEvaluator::visit(const CondNode& node) {
+	measure(node, &profile.ops, "?:");
+}
+
+void ProfilingEvaluator::visit(const LetNode& node) {
+	measure(node, &profile.ops, "let");
+}
+
+void ProfilingEvaluator::visit(const GroupNode& node) {
+	measure(node, nullptr, "");
+}
+
+void ProfilingEvaluator::visit(const FuncNode& node) {
+	measure(node, &profile.funcs, node.id);
+}
+
+void ProfilingEvaluator::visit(const VarNode& node) {
+	measure(node, nullptr, "");
+}
+
+void ProfilingEvaluator::visit(const NumNode& node) {
+	measure(node, nullptr, "");
+}
+
+void ProfileStringifier::annotate(const ASTNode& node) {
+	const auto& entry = profile.node(node);
+	str += "[" + std::to_string(entry.hits) + "x " + std::to_string(entry.total.count()) + "ns]";
+}
+
+void ProfileStringifier::visit(const BinaryNode& node) {
+	Stringifier::visit(node);
+	str = "{" + str + "}";
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const UnaryNode& node) {
+	Stringifier::visit(node);
+	str = "{" + str + "}";
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const LogicalNode& node) {
+	Stringifier::visit(node);
+	str = "{" + str + "}";
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const CondNode& node) {
+	Stringifier::visit(node);
+	str = "{" + str + "}";
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const LetNode& node) {
+	Stringifier::visit(node);
+	str = "{" + str + "}";
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const GroupNode& node) {
+	Stringifier::visit(node);
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const FuncNode& node) {
+	Stringifier::visit(node);
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const VarNode& node) {
+	Stringifier::visit(node);
+	annotate(node);
+}
+
+void ProfileStringifier::visit(const NumNode& node) {
+	Stringifier::visit(node);
+	annotate(node);
+}
+
+#endif
@@ -0,0 +1,417 @@
+#include "program.hpp"
+
+#include "ast.hpp"
+#include "visitor.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <concepts>
+#include <complex>
+#include <cmath>
+#include <expected>
+#include <cstdint>
+
+namespace {
+
+template <typename T>
+bool finite(const T& value) noexcept {
+	if constexpr (std::floating_point<T>) {
+		return std::isfinite(value);
+	} else {
+		return std::isfinite(value.real()) && std::isfinite(value.imag());
+	}
+}
+
+constexpr std::size_t arguments(OpCode op, std::size_t count) noexcept {
+	switch (op) {
+		case OpCode::add: case OpCode::sub: case OpCode::mul: case OpCode::div: case OpCode::binary: return 2;
+		case OpCode::fma: return 3;
+		case OpCode::unary: return 1;
+		case OpCode::native: case OpCode::call: return count;
+		default: return 0;
+	}
+}
+
+// a fault is raised only where it appears: results of already faulty operands pass through unmarked
+template <typename T>
+std::uint8_t classify(const T& value, std::span<const T> operands) noexcept {
+	if (finite(value) || std::ranges::any_of(operands, [](const T& x) { return x != x; })) {
+		return 0;
+	}
+	if (value != value) {
+		return std::to_underlying(Fault::domain);
+	}
+	return std::ranges::all_of(operands, [](const T& x) { return finite(x); }) ? std::to_underlying(Fault::overflow) : 0;
+}
+
+}
+
+template <typename T>
+T Program<T>::run(Context<T>& context, std::span<const T> vars) const {
+
+	if (vars.size() < names.size()) {
+		throw std::runtime_error("Missing variable values");
+	}
+	if (context.stack.size() < depth || context.locals.size() < frame || context.args.capacity() < arity || context.returns.size() < calls) {
+		throw std::runtime_error("Context does not fit program");
+	}
+
+	std::uint8_t fault = 0;
+	return execute<false>(context, vars.data(), fault);
+}
+
+template <typename T>
+std::expected<void, std::string> Program<T>::run(Context<T>& context, const Columns<T>& vars, std::span<T> out, std::span<std::uint8_t> faults) const {
+
+	if (context.stack.size() < depth || context.locals.size() < frame || context.args.capacity() < arity || context.returns.size() < calls
+		|| context.row.size() < names.size() || context.sources.size() < names.size()) {
+		return std::unexpected("Context does not fit program");
+	}
+	if (faults.size() < out.size()) {
+		return std::unexpected("Fault mask is shorter than output");
+	}
+	for (std::size_t i = 0; i < names.size(); ++i) {
+		auto it = vars.find(names[i]);
+		if (it == vars.end()) {
+			return std::unexpected("Variable not found");
+		}
+		if (it->second.size() < out.size()) {
+			return std::unexpected("Column is shorter than output");
+		}
+		context.sources[i] = it->second.data();
+	}
+
+	for (std::size_t row = 0; row < out.size(); ++row) {
+		for (std::size_t i = 0; i < names.size(); ++i) {
+			context.row[i] = context.sources[i][row];
+		}
+		std::uint8_t fault = 0;
+		out[row] = execute<true>(context, context.row.data(), fault);
+		if (out[row] != out[row]) {
+			fault |= std::to_underlying(Fault::invalid);
+		}
+		faults[row] = fault;
+	}
+	return {};
+}
+
+template <typename T>
+template <bool checked>
+T Program<T>::execute(Context<T>& context, const T* vars, std::uint8_t& fault) const {
+
+	auto stack = context.stack.data();
+	auto locals = context.locals.data();
+	auto returns = context.returns.data();
+	std::size_t sp = 0, pc = 0, base = 0, calls = 0;
+
+	T operands[3];
+
+	while (pc < code.size()) {
+		auto [op, arg, count] = code[pc++];
+		std::size_t inputs = 0;
+		if constexpr (checked) {
+			inputs = arguments(op, count);
+			if (op != OpCode::call) {
+				std::copy_n(stack + sp - inputs, inputs, operands);
+			}
+		}
+		switch (op) {
+			case OpCode::push: stack[sp++] = constants[arg]; break;
+			case OpCode::load_var: stack[sp++] = vars[arg]; break;
+			case OpCode::load_local: stack[sp++] = locals[base + arg]; break;
+			case OpCode::store_local: locals[base + arg] = stack[--sp]; break;
+			case OpCode::add: --sp; stack[sp - 1] += stack[sp]; break;
+			case OpCode::sub: --sp; stack[sp - 1] -= stack[sp]; break;
+			case OpCode::mul: --sp; stack[sp - 1] *= stack[sp]; break;
+			case OpCode::div: --sp; stack[sp - 1] /= stack[sp]; break;
+			case OpCode::neg: stack[sp - 1] = -stack[sp - 1]; break;
+			case OpCode::fma:
+				sp -= 2;
+				if constexpr (std::floating_point<T>) {
+					stack[sp - 1] = std::fma(stack[sp - 1], stack[sp], stack[sp + 1]);
+				} else {
+					stack[sp - 1] = stack[sp - 1] * stack[sp] + stack[sp + 1];
+				}
+				break;
+			case OpCode::binary: --sp; stack[sp - 1] = binaries[arg](stack[sp - 1], stack[sp]); break;
+			case OpCode::unary: stack[sp - 1] = unaries[arg](stack[sp - 1]); break;
+			case OpCode::native:
+				sp -= count;
+				stack[sp] = natives[arg](stack + sp);
+				++sp;
+				break;
+			case OpCode::call:
+				sp -= count;
+				context.args.assign(stack + sp, stack + sp + count);
+				stack[sp++] = functions[arg](context.args);
+				break;
+			case OpCode::truth: stack[sp - 1] = stack[sp - 1] != T(0) ? T(1) : T(0); break;
+			case OpCode::jump: pc = arg; break;
+			case OpCode::jump_if: if (stack[--sp] != T(0)) pc = arg; break;
+			case OpCode::jump_unless: if (stack[--sp] == T(0)) pc = arg; break;
+			case OpCode::invoke:
+				returns[calls++] = {static_cast<std::uint32_t>(pc), static_cast<std::uint32_t>(base)};
+				base += count;
+				pc = arg;
+				break;
+			case OpCode::ret:
+				--calls;
+				pc = returns[calls].pc;
+				base = returns[calls].base;
+				break;
+		}
+		if constexpr (checked) {
+			if (op == OpCode::div && operands[1] == T(0)) {
+				fault |= std::to_underlying(Fault::division);
+			} else if (inputs) {
+				auto in = op == OpCode::call ? std::span<const T>(context.args) : std::span<const T>(operands, inputs);
+				fault |= classify(stack[sp - 1], in);
+			}
+		}
+	}
+	return stack[0];
+}
+
+template <typename T>
+std::size_t Program<T>::index(std::string_view id) const {
+	if (auto it = std::ranges::find(names, id); it != names.end()) {
+		return static_cast<std::size_t>(it - names.begin());
+	}
+	throw std::runtime_error("Variable not found");
+}
+
+template <typename T>
+std::expected<Program<T>, std::string> Compiler<T>::compile(const ASTNode& root) {
+	root.accept(*this);
+	if (!error.empty()) {
+		return std::unexpected(std::move(error));
+	}
+	return std::move(program);
+}
+
+template <typename T>
+void Compiler<T>::visit(const BinaryNode& node) {
+
+	node.left->accept(*this);
+	node.right->accept(*this);
+
+	if (node.op == "+") {
+		emit(OpCode::add);
+	} else if (node.op == "-") {
+		emit(OpCode::sub);
+	} else if (node.op == "*") {
+		emit(OpCode::mul);
+	} else if (node.op == "/") {
+		emit(OpCode::div);
+	} else {
+		auto op = binary_table<T>.find(node.op);
+		if (!op || !op->call) {
+			error = "Operator not supported";
+			return;
+		}
+		program.binaries.push_back(op->call);
+		emit(OpCode::binary, program.binaries.size() - 1);
+	}
+}
+
+template <typename T>
+void Compiler<T>::visit(const UnaryNode& node) {
+
+	node.base->accept(*this);
+
+	if (node.op == "-") {
+		emit(OpCode::neg);
+	} else if (node.op != "+") {
+		program.unaries.push_back(unary_table<T>.find(node.op)->call);
+		emit(OpCode::unary, program.unaries.size() - 1);
+	}
+}
+
+template <typename T>
+void Compiler<T>::visit(const LogicalNode& node) {
+
+	node.left->accept(*this);
+	auto shortcut = emit(node.op == "&&" ? OpCode::jump_unless : OpCode::jump_if);
+	node.right->accept(*this);
+	emit(OpCode::truth);
+	auto done = emit(OpCode::jump);
+
+	patch(shortcut);
+	--height;
+	program.constants.push_back(node.op == "&&" ? T(0) : T(1));
+	emit(OpCode::push, program.constants.size() - 1);
+	patch(done);
+}
+
+template <typename T>
+void Compiler<T>::visit(const CondNode& node) {
+
+	node.cond->accept(*this);
+	auto otherwise = emit(OpCode::jump_unless);
+	node.on_true->accept(*this);
+	auto done = emit(OpCode::jump);
+
+	patch(otherwise);
+	--height;
+	node.on_false->accept(*this);
+	patch(done);
+}
+
+template <typename T>
+void Compiler<T>::visit(const LetNode& node) {
+
+	auto scope = depth;
+	for (auto& binding : node.bindings) {
+		binding.value->accept(*this);
+		store(binding.slot);
+		depth = binding.slot + 1;
+	}
+	node.body->accept(*this);
+	depth = scope;
+}
+
+template <typename T>
+void Compiler<T>::visit(const GroupNode& node) {
+	node.base->accept(*this);
+}
+
+template <typename T>
+void Compiler<T>::visit(const FuncNode& node) {
+
+	for (auto& arg : node.args) {
+		arg->accept(*this);
+	}
+
+	if (node.definition) {
+		auto& callee = subroutine(*node.definition);
+		auto site = height - node.args.size();
+		program.depth = std::max(program.depth, site + callee.depth);
+		program.frame = std::max(program.frame, depth + callee.frame);
+		program.calls = std::max(program.calls, callee.calls + 1);
+		emit(OpCode::invoke, callee.entry, depth);
+		height = site + 1;
+		return;
+	}
+
+	auto native = builtin<T>(node.id, node.args.size(), accuracy);
+	if (!native) {
+		error = native.error();
+		return;
+	}
+	if (node.id == "fma" && *native) {
+		emit(OpCode::fma);
+		return;
+	}
+
+	if (*native) {
+		program.natives.push_back(*native);
+		emit(OpCode::native, program.natives.size() - 1, node.args.size());
+		return;
+	}
+	if (auto it = funcs.find(node.id); it != funcs.end()) {
+		program.functions.push_back(it->second);
+	} else {
+		error = "Function not found";
+		return;
+	}
+	program.arity = std::max(program.arity, node.args.size());
+	emit(OpCode::call, program.functions.size() - 1, node.args.size());
+}
+
+template <typename T>
+void Compiler<T>::visit(const VarNode& node) {
+
+	if (node.slot) {
+		emit(OpCode::load_local, *node.slot);
+	} else if (auto constant = constant_table.find(node.id)) {
+		program.constants.push_back(static_cast<T>(constant->value));
+		emit(OpCode::push, program.constants.size() - 1);
+	} else if (auto it = std::ranges::find(program.names, node.id); it != program.names.end()) {
+		emit(OpCode::load_var, static_cast<std::size_t>(it - program.names.begin()));
+	} else {
+		program.names.push_back(node.id);
+		emit(OpCode::load_var, program.names.size() - 1);
+	}
+}
+
+template <typename T>
+void Compiler<T>::visit(const NumNode& node) {
+	program.constants.push_back(static_cast<T>(node.value));
+	emit(OpCode::push, program.constants.size() - 1);
+}
+
+template <typename T>
+std::size_t Compiler<T>::emit(OpCode op, std::size_t arg, std::size_t count) {
+
+	switch (op) {
+		case OpCode::push: case OpCode::load_var: case OpCode::load_local: ++height; break;
+		case OpCode::store_local: case OpCode::jump_if: case OpCode::jump_unless: --height; break;
+		case OpCode::add: case OpCode::sub: case OpCode::mul: case OpCode::div: case OpCode::binary: --height; break;
+		case OpCode::fma: height -= 2; break;
+		case OpCode::native: case OpCode::call: height = height - count + 1; break;
+		case OpCode::neg: case OpCode::unary: case OpCode::truth: case OpCode::jump: break;
+		case OpCode::invoke: case OpCode::ret: break;
+	}
+	program.depth = std::max(program.depth, height);
+
+	program.code.push_back({op, static_cast<std::uint32_t>(arg), static_cast<std::uint32_t>(count)});
+	return program.code.size() - 1;
+}
+
+template <typename T>
+void Compiler<T>::patch(std::size_t at) noexcept {
+	program.code[at].arg = static_cast<std::uint32_t>(program.code.size());
+}
+
+template <typename T>
+void Compiler<T>::store(std::size_t slot) {
+	program.frame = std::max(program.frame, slot + 1);
+	emit(OpCode::store_local, slot);
+}
+
+// compiled in place behind a jump the first time it is called; the body starts with its arguments on the stack
+// and measures depth, frame and calls from its own call site, so every caller can add them to where it stands
+template <typename T>
+const typename Compiler<T>::Subroutine& Compiler<T>::subroutine(const Definition& definition) {
+
+	if (auto it = subroutines.find(&definition); it != subroutines.end()) {
+		return it->second;
+	}
+
+	auto arity = definition.params.size();
+	auto skip = emit(OpCode::jump);
+	auto caller_height = std::exchange(height, arity);
+	auto caller_scope = std::exchange(depth, arity);
+	auto caller_depth = std::exchange(program.depth, arity);
+	auto caller_frame = std::exchange(program.frame, arity);
+	auto caller_calls = std::exchange(program.calls, 0);
+
+	auto entry = static_cast<std::uint32_t>(program.code.size());
+	for (auto i = arity; i-- > 0;) {
+		store(i);
+	}
+	definition.body->accept(*this);
+	emit(OpCode::ret);
+	Subroutine compiled{entry, program.depth, program.frame, program.calls};
+
+	height = caller_height;
+	depth = caller_scope;
+	program.depth = caller_depth;
+	program.frame = caller_frame;
+	program.calls = caller_calls;
+	patch(skip);
+	return subroutines.emplace(&definition, compiled).first->second;
+}
+
+template class Program<float>;
+template class Program<double>;
+template class Program<std::complex<double>>;
+
+template class Compiler<float>;
+template class Compiler<double>;
+template class Compiler<std::complex<double>>;
@@ -0,0 +1,71 @@
+#include "protocol.hpp"
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#include <sys/socket.h>
+
+namespace {
+
+bool send_all(int fd, const char* data, std::size_t size) noexcept {
+	while (size) {
+		auto sent = ::send(fd, data, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) {
+			continue;
+		}
+		if (sent <= 0) {
+			return false;
+		}
+		data += sent;
+		size -= static_cast<std::size_t>(sent);
+	}
+	return true;
+}
+
+bool receive_all(int fd, char* data, std::size_t size) {
+	while (size) {
+		auto received = ::recv(fd, data, size, 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			return false;
+		}
+		data += received;
+		size -= static_cast<std::size_t>(received);
+	}
+	return true;
+}
+
+}
+
+bool send_frame(int fd, std::uint8_t kind, std::string_view payload) noexcept {
+	char header[5];
+	auto length = static_cast<std::uint32_t>(payload.size());
+	std::memcpy(header, &length, sizeof(length));
+	header[4] = static_cast<char>(kind);
+	return send_all(fd, header, sizeof(header)) && send_all(fd, payload.data(), payload.size());
+}
+
+std::optional<Frame> receive_frame(int fd) {
+	char header[5];
+	if (!receive_all(fd, header, sizeof(header))) {
+		return std::nullopt;
+	}
+	std::uint32_t length;
+	std::memcpy(&length, header, sizeof(length));
+	if (length > max_frame) {
+		throw std::runtime_error("Frame too large");
+	}
+
+	Frame frame{static_cast<std::uint8_t>(header[4]), std::string(length, '\0')};
+	if (!receive_all(fd, frame.payload.data(), length)) {
+		return std::nullopt;
+	}
+	return frame;
+}
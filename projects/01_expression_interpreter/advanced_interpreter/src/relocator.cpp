@@ -0,0 +1,40 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+Node Relocator::relocate(Node root) {
+	if (shift) {
+		rewrite(root);
+	}
+	return root;
+}
+
+void Relocator::visit(const LetNode& node) {
+	auto changed = false;
+	std::vector<Binding> bindings;
+	for (auto& binding : node.bindings) {
+		auto value = binding.value;
+		rewrite(value);
+		changed |= value != binding.value || slot(binding.slot) != binding.slot;
+		bindings.emplace_back(binding.id, slot(binding.slot), std::move(value));
+	}
+	auto body = node.body;
+	rewrite(body);
+	if (changed || body != node.body) {
+		replacement = std::make_shared<LetNode>(std::move(bindings), std::move(body));
+	}
+}
+
+void Relocator::visit(const VarNode& node) {
+	if (node.slot && slot(*node.slot) != *node.slot) {
+		replacement = std::make_shared<VarNode>(node.id, slot(*node.slot));
+	}
+}
+
+std::size_t Relocator::slot(std::size_t slot) const noexcept {
+	return slot >= threshold ? slot + shift : slot;
+}
@@ -0,0 +1,114 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+
+#include <vector>
+#include <memory>
+#include <map>
+#include <utility>
+
+void Rewriter::rewrite(Node& node) {
+	if (pure) {
+		auto [it, inserted] = rewritten.try_emplace({node.get(), depth});
+		if (inserted) {
+			node->accept(*this);
+			it->second = replacement ? std::move(replacement) : node;
+		}
+		node = it->second;
+		return;
+	}
+	node->accept(*this);
+	if (replacement) {
+		node = std::move(replacement);
+	}
+}
+
+void Rewriter::visit(const BinaryNode& node) {
+	auto left = node.left, right = node.right;
+	rewrite(left);
+	rewrite(right);
+	if (left != node.left || right != node.right) {
+		replacement = std::make_shared<BinaryNode>(node.op, std::move(left), std::move(right));
+	}
+}
+
+void Rewriter::visit(const UnaryNode& node) {
+	auto base = node.base;
+	rewrite(base);
+	if (base != node.base) {
+		replacement = std::make_shared<UnaryNode>(node.op, std::move(base));
+	}
+}
+
+void Rewriter::visit(const LogicalNode& node) {
+	auto left = node.left, right = node.right;
+	rewrite(left);
+	rewrite(right);
+	if (left != node.left || right != node.right) {
+		replacement = std::make_shared<LogicalNode>(node.op, std::move(left), std::move(right));
+	}
+}
+
+void Rewriter::visit(const CondNode& node) {
+	auto cond = node.cond, on_true = node.on_true, on_false = node.on_false;
+	rewrite(cond);
+	rewrite(on_true);
+	rewrite(on_false);
+	if (cond != node.cond || on_true != node.on_true || on_false != node.on_false) {
+		replacement = std::make_shared<CondNode>(std::move(cond), std::move(on_true), std::move(on_false));
+	}
+}
+
+void Rewriter::visit(const LetNode& node) {
+	auto base = depth;
+	auto changed = false;
+	std::vector<Binding> bindings;
+	for (auto& binding : node.bindings) {
+		auto value = binding.value;
+		rewrite(value);
+		changed |= value != binding.value;
+		bindings.emplace_back(binding.id, binding.slot, std::move(value));
+		depth = binding.slot + 1;
+	}
+	auto body = node.body;
+	rewrite(body);
+	depth = base;
+	if (changed || body != node.body) {
+		replacement = std::make_shared<LetNode>(std::move(bindings), std::move(body));
+	}
+}
+
+void Rewriter::visit(const GroupNode& node) {
+	auto base = node.base;
+	rewrite(base);
+	if (base != node.base) {
+		replacement = std::make_shared<GroupNode>(std::move(base));
+	}
+}
+
+void Rewriter::visit(const FuncNode& node) {
+	auto args = node.args;
+	for (auto& arg : args) {
+		rewrite(arg);
+	}
+	if (args != node.args) {
+		replacement = std::make_shared<FuncNode>(node.id, std::move(args), node.definition);
+	}
+}
+
+void Rewriter::visit(const VarNode&) {}
+
+void Rewriter::visit(const NumNode&) {}
+
+std::shared_ptr<const Definition> Rewriter::relink(const std::shared_ptr<const Definition>& definition) {
+	if (auto it = relinked.find(definition.get()); it != relinked.end()) {
+		return it->second;
+	}
+	auto body = definition->body;
+	auto outer = std::exchange(depth, definition->params.size());
+	rewrite(body);
+	depth = outer;
+	auto result = body == definition->body ? definition : std::make_shared<const Definition>(definition->id, definition->params, std::move(body));
+	relinked.emplace(definition.get(), result);
+	return result;
+}
@@ -0,0 +1,351 @@
+#include "server.hpp"
+
+#include "expression.hpp"
+#include "program.hpp"
+#include "protocol.hpp"
+#include "library.hpp"
+#include "analysis.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <span>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct Server::Pending {
+	std::uint32_t count;
+	std::string_view rows;
+	std::span<double> out;
+	std::span<std::uint8_t> faults;
+	std::string error;
+	bool done = false;
+};
+
+struct Server::Entry {
+	Program<double> program;
+	std::vector<std::string> names;
+
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::vector<Pending*> queue;
+	bool busy = false;
+
+	// owned by whichever request is currently running the batch
+	Context<double> context;
+	std::vector<std::vector<double>> columns;
+	std::vector<double> out;
+	std::vector<std::uint8_t> faults;
+
+	explicit Entry(Program<double>&& compiled)
+		: program(std::move(compiled)), names(program.variables()), context(program), columns(names.size()) {}
+};
+
+Server::Server(std::string path, std::size_t capacity, const Limits& limits, std::size_t connections)
+	: path(std::move(path)), capacity(std::max<std::size_t>(capacity, 1)), limits(limits), connections(std::max<std::size_t>(connections, 1)) {
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (this->path.size() >= sizeof(address.sun_path)) {
+		throw std::runtime_error("Socket path too long");
+	}
+	std::memcpy(address.sun_path, this->path.c_str(), this->path.size() + 1);
+
+	listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener < 0) {
+		throw std::runtime_error("Cannot create socket");
+	}
+	::unlink(this->path.c_str());
+	if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listener, 64) < 0) {
+		::close(listener);
+		throw std::runtime_error("Cannot listen on " + this->path + ": " + std::strerror(errno));
+	}
+}
+
+Server::~Server() {
+	stop();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	::close(listener);
+	::unlink(path.c_str());
+}
+
+void Server::serve() {
+
+	running = true;
+	while (running) {
+		int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			break;
+		}
+		std::unique_lock lock(mutex);
+		std::erase_if(threads, [this](std::thread& thread) {
+			if (std::ranges::find(finished, thread.get_id()) == finished.end()) {
+				return false;
+			}
+			thread.join();
+			return true;
+		});
+		finished.clear();
+		// the reply is already waiting when the client sends its first request
+		if (clients.size() >= connections) {
+			lock.unlock();
+			send_frame(client, std::to_underlying(Status::error), "Too many connections");
+			::close(client);
+			continue;
+		}
+		clients.push_back(client);
+		threads.emplace_back(&Server::handle, this, client);
+	}
+
+	running = false;
+	{
+		std::scoped_lock lock(mutex);
+		for (int client : clients) {
+			::shutdown(client, SHUT_RDWR);
+		}
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+	finished.clear();
+}
+
+// only async-signal-safe calls: shutting the listener down wakes accept
+void Server::stop() noexcept {
+	running = false;
+	::shutdown(listener, SHUT_RDWR);
+}
+
+ServerStats Server::stats() const {
+	std::scoped_lock lock(mutex);
+	return {requests.load(), batches.load(), rows.load(), entries.size()};
+}
+
+void Server::handle(int client) {
+
+	try {
+		while (auto frame = receive_frame(client)) {
+			++requests;
+			std::string reply;
+			auto status = Status::ok;
+			try {
+				switch (static_cast<Request>(frame->kind)) {
+					case Request::compile: reply = compile(frame->payload); break;
+					case Request::evaluate: reply = evaluate(frame->payload); break;
+					case Request::stats: reply = report(); break;
+					default: throw std::runtime_error("Unknown request");
+				}
+			} catch (const std::exception& error) {
+				status = Status::error;
+				reply = error.what();
+			}
+			if (!send_frame(client, std::to_underlying(status), reply)) {
+				break;
+			}
+		}
+	} catch (const std::exception&) {
+		// a malformed frame header leaves the stream unsynchronized: drop the connection
+	}
+
+	std::scoped_lock lock(mutex);
+	std::erase(clients, client);
+	finished.push_back(std::this_thread::get_id());
+	::close(client);
+}
+
+std::string Server::compile(std::string_view text) {
+
+	std::string key(text);
+	{
+		std::scoped_lock lock(mutex);
+		if (auto it = handles.find(key); it != handles.end()) {
+			auto& slot = entries.at(it->second);
+			order.splice(order.begin(), order, slot.position);
+			Writer writer;
+			writer.put(it->second);
+			writer.put(static_cast<std::uint32_t>(slot.entry->names.size()));
+			for (auto& name : slot.entry->names) {
+				writer.put(std::string_view(name));
+			}
+			return writer.data();
+		}
+	}
+
+	auto expression = Expression::parse(key, Library(), Accuracy::exact, limits);
+	if (!expression) {
+		throw std::runtime_error(expression.error());
+	}
+	auto program = expression->bind<double>();
+	if (!program) {
+		throw std::runtime_error(program.error());
+	}
+	auto entry = std::make_shared<Entry>(std::move(*program));
+
+	std::scoped_lock lock(mutex);
+	std::uint64_t handle;
+	if (auto it = handles.find(key); it != handles.end()) {
+		handle = it->second;
+		entry = entries.at(handle).entry;
+	} else {
+		handle = next++;
+		order.push_front(handle);
+		entries.emplace(handle, Slot{key, entry, order.begin()});
+		handles.emplace(std::move(key), handle);
+		if (entries.size() > capacity) {
+			auto victim = entries.find(order.back());
+			handles.erase(victim->second.text);
+			entries.erase(victim);
+			order.pop_back();
+		}
+	}
+
+	Writer writer;
+	writer.put(handle);
+	writer.put(static_cast<std::uint32_t>(entry->names.size()));
+	for (auto& name : entry->names) {
+		writer.put(std::string_view(name));
+	}
+	return writer.data();
+}
+
+std::shared_ptr<Server::Entry> Server::find(std::uint64_t handle) {
+	std::scoped_lock lock(mutex);
+	auto it = entries.find(handle);
+	if (it == entries.end()) {
+		throw std::runtime_error("Unknown expression handle");
+	}
+	order.splice(order.begin(), order, it->second.position);
+	return it->second.entry;
+}
+
+std::string Server::evaluate(std::string_view payload) {
+
+	Reader reader(payload);
+	auto entry = find(reader.get<std::uint64_t>());
+	auto count = reader.get<std::uint32_t>();
+	auto width = entry->names.size() * sizeof(double);
+	// the request fit in a frame, but with no variables its row count is unbounded; the reply has to fit as well
+	if (count > max_rows) {
+		throw std::runtime_error("Too many rows");
+	}
+	if (reader.remaining() != count * width) {
+		throw std::runtime_error("Malformed frame");
+	}
+
+	std::vector<double> out(count);
+	std::vector<std::uint8_t> faults(count);
+	Pending pending{count, reader.take(count * width), out, faults, {}, false};
+
+	// flat combining: whoever finds the entry idle runs everything queued so far, including requests that arrive meanwhile
+	std::unique_lock lock(entry->mutex);
+	entry->queue.push_back(&pending);
+	while (!pending.done) {
+		if (entry->busy) {
+			entry->ready.wait(lock);
+			continue;
+		}
+		entry->busy = true;
+		auto batch = std::exchange(entry->queue, {});
+		lock.unlock();
+		run(*entry, batch);
+		lock.lock();
+		for (auto request : batch) {
+			request->done = true;
+		}
+		entry->busy = false;
+		entry->ready.notify_all();
+	}
+	lock.unlock();
+
+	if (!pending.error.empty()) {
+		throw std::runtime_error(pending.error);
+	}
+	Writer writer;
+	writer.put(count);
+	writer.append(std::string_view(reinterpret_cast<const char*>(out.data()), out.size() * sizeof(double)));
+	writer.append(std::string_view(reinterpret_cast<const char*>(faults.data()), faults.size()));
+	return writer.data();
+}
+
+// never throws, so the combining loop always hands the entry back; a failure is reported to every request in the batch
+void Server::run(Entry& entry, std::span<Pending*> batch) noexcept {
+	try {
+		combine(entry, batch);
+	} catch (const std::exception& error) {
+		for (auto request : batch) {
+			request->error = error.what();
+		}
+	}
+}
+
+void Server::combine(Entry& entry, std::span<Pending*> batch) {
+
+	std::size_t total = 0;
+	for (auto request : batch) {
+		total += request->count;
+	}
+
+	auto width = entry.names.size();
+	for (auto& column : entry.columns) {
+		column.resize(total);
+	}
+	std::size_t offset = 0;
+	for (auto request : batch) {
+		for (std::size_t row = 0; row < request->count; ++row) {
+			for (std::size_t i = 0; i < width; ++i) {
+				std::memcpy(&entry.columns[i][offset + row], request->rows.data() + (row * width + i) * sizeof(double), sizeof(double));
+			}
+		}
+		offset += request->count;
+	}
+
+	Columns<double> columns;
+	for (std::size_t i = 0; i < width; ++i) {
+		columns.emplace(entry.names[i], entry.columns[i]);
+	}
+	entry.out.resize(total);
+	entry.faults.resize(total);
+	auto result = entry.program.run(entry.context, columns, entry.out, entry.faults);
+
+	offset = 0;
+	for (auto request : batch) {
+		if (!result) {
+			request->error = result.error();
+		} else {
+			std::copy_n(entry.out.begin() + offset, request->count, request->out.begin());
+			std::copy_n(entry.faults.begin() + offset, request->count, request->faults.begin());
+		}
+		offset += request->count;
+	}
+
+	++batches;
+	rows += total;
+}
+
+std::string Server::report() const {
+	auto current = stats();
+	Writer writer;
+	writer.put(current.requests);
+	writer.put(current.batches);
+	writer.put(current.rows);
+	writer.put(current.cached);
+	return writer.data();
+}
@@ -0,0 +1,193 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+#include "visitor.hpp"
+#include "registry.hpp"
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+std::optional<double> constant(const ASTNode& node) {
+	if (auto num = dynamic_cast<const NumNode*>(&node)) {
+		return num->value;
+	}
+	if (auto group = dynamic_cast<const GroupNode*>(&node)) {
+		return constant(*group->base);
+	}
+	if (auto unary = dynamic_cast<const UnaryNode*>(&node)) {
+		if (auto value = constant(*unary->base)) {
+			return unary->op == "-" ? -*value : *value;
+		}
+	}
+	return std::nullopt;
+}
+
+Node number(double value) {
+	if (std::signbit(value) && !std::isnan(value)) {
+		return std::make_shared<GroupNode>(std::make_shared<UnaryNode>("-", std::make_shared<NumNode>(-value)));
+	}
+	return std::make_shared<NumNode>(value);
+}
+
+Node truth(Node node) {
+	return std::make_shared<BinaryNode>("!=", std::move(node), std::make_shared<NumNode>(0.));
+}
+
+}
+
+void Specializer::specialize(Node& node) {
+	rewrite(node);
+}
+
+void Specializer::visit(const BinaryNode& node) {
+	auto left = node.left, right = node.right;
+	specialize(left);
+	specialize(right);
+
+	auto lhs = constant(*left);
+	auto rhs = constant(*right);
+	if (lhs && rhs) {
+		replacement = fold(BinaryNode(node.op, left, right));
+	} else if (rhs == 1. && (node.op == "*" || node.op == "/" || node.op == "^")) {
+		replacement = std::move(left);
+	} else if (lhs == 1. && node.op == "*") {
+		replacement = std::move(right);
+	} else if (rhs == 0. && !std::signbit(*rhs) && node.op == "-") {
+		replacement = std::move(left);
+	} else if (left != node.left || right != node.right) {
+		replacement = std::make_shared<BinaryNode>(node.op, std::move(left), std::move(right));
+	}
+}
+
+void Specializer::visit(const UnaryNode& node) {
+	auto base = node.base;
+	specialize(base);
+	if (constant(*base)) {
+		replacement = fold(UnaryNode(node.op, base));
+	} else if (node.op == "+") {
+		replacement = std::move(base);
+	} else if (base != node.base) {
+		replacement = std::make_shared<UnaryNode>(node.op, std::move(base));
+	}
+}
+
+void Specializer::visit(const LogicalNode& node) {
+	auto left = node.left, right = node.right;
+	specialize(left);
+	specialize(right);
+
+	auto lhs = constant(*left);
+	if (lhs && constant(*right)) {
+		replacement = fold(LogicalNode(node.op, left, right));
+	} else if (lhs) {
+		auto shortcut = node.op == "&&" ? *lhs == 0. : *lhs != 0.;
+		replacement = shortcut ? number(node.op == "&&" ? 0. : 1.) : truth(std::move(right));
+	} else if (left != node.left || right != node.right) {
+		replacement = std::make_shared<LogicalNode>(node.op, std::move(left), std::move(right));
+	}
+}
+
+void Specializer::visit(const CondNode& node) {
+	auto cond = node.cond;
+	specialize(cond);
+	if (auto value = constant(*cond)) {
+		auto branch = *value != 0. ? node.on_true : node.on_false;
+		specialize(branch);
+		replacement = std::move(branch);
+		return;
+	}
+	auto on_true = node.on_true, on_false = node.on_false;
+	specialize(on_true);
+	specialize(on_false);
+	if (cond != node.cond || on_true != node.on_true || on_false != node.on_false) {
+		replacement = std::make_shared<CondNode>(std::move(cond), std::move(on_true), std::move(on_false));
+	}
+}
+
+void Specializer::visit(const LetNode& node) {
+	auto changed = false;
+	std::vector<Binding> bindings;
+	std::vector<std::size_t> slots;
+	for (auto& binding : node.bindings) {
+		auto value = binding.value;
+		specialize(value);
+		if (auto number = constant(*value)) {
+			known[binding.slot] = *number;
+			changed = true;
+		} else {
+			known.erase(binding.slot);
+			changed |= value != binding.value;
+			bindings.emplace_back(binding.id, binding.slot, std::move(value));
+		}
+		slots.push_back(binding.slot);
+	}
+	auto body = node.body;
+	specialize(body);
+	for (auto slot : slots) {
+		known.erase(slot);
+	}
+
+	if (bindings.empty()) {
+		replacement = std::move(body);
+	} else if (changed || body != node.body) {
+		replacement = std::make_shared<LetNode>(std::move(bindings), std::move(body));
+	}
+}
+
+void Specializer::visit(const GroupNode& node) {
+	auto base = node.base;
+	specialize(base);
+	if (auto value = constant(*base)) {
+		replacement = number(*value);
+	} else if (base != node.base) {
+		replacement = std::make_shared<GroupNode>(std::move(base));
+	}
+}
+
+void Specializer::visit(const FuncNode& node) {
+	auto args = node.args;
+	for (auto& arg : args) {
+		specialize(arg);
+	}
+	auto foldable = !node.definition && builtin_table<double>.find(node.id)
+		&& std::ranges::all_of(args, [](const Node& arg) { return constant(*arg).has_value(); });
+	if (foldable) {
+		replacement = fold(FuncNode(node.id, std::move(args)));
+		return;
+	}
+
+	// the body of a linked definition sees the bindings too, but none of the caller's known locals
+	auto definition = node.definition;
+	if (definition) {
+		auto outer = std::exchange(known, {});
+		definition = relink(definition);
+		known = std::move(outer);
+	}
+	if (args != node.args || definition != node.definition) {
+		replacement = std::make_shared<FuncNode>(node.id, std::move(args), std::move(definition));
+	}
+}
+
+void Specializer::visit(const VarNode& node) {
+	if (node.slot) {
+		if (auto it = known.find(*node.slot); it != known.end()) {
+			replacement = number(it->second);
+		}
+	} else if (auto constant = constant_table.find(node.id)) {
+		replacement = number(constant->value);
+	} else if (auto it = bindings.find(node.id); it != bindings.end()) {
+		replacement = number(it->second);
+	}
+}
+
+Node Specializer::fold(const ASTNode& node) const {
+	static const Variables<double> vars;
+	static const Functions<double> funcs;
+	return number(BasicEvaluator<double>(vars, funcs, accuracy).evaluate(node));
+}
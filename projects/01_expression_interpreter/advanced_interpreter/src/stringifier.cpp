@@ -4,12 +4,12 @@
 
 #include <string>
 
-std::string Stringifier::stringify(ASTNode& root) {
+std::string Stringifier::stringify(const ASTNode& root) {
 	root.accept(*this);
 	return str;
 }
 
-void Stringifier::visit(BinaryNode& node) {
+void Stringifier::visit(const BinaryNode& node) {
 	node.left->accept(*this);
 	auto left = str;
 	node.right->accept(*this);
@@ -17,17 +17,48 @@ void Stringifier::visit(BinaryNode& node) {
 	str = left + node.op + str;
 }
 
-void Stringifier::visit(UnaryNode& node) {
+void Stringifier::visit(const UnaryNode& node) {
 	node.base->accept(*this);
 	str = node.op + str;
 }
 
-void Stringifier::visit(GroupNode& node) {
+void Stringifier::visit(const LogicalNode& node) {
+	node.left->accept(*this);
+	auto left = str;
+	node.right->accept(*this);
+
+	str = left + node.op + str;
+}
+
+void Stringifier::visit(const CondNode& node) {
+	node.cond->accept(*this);
+	auto cond = str;
+	node.on_true->accept(*this);
+	auto on_true = str;
+	node.on_false->accept(*this);
+
+	str = cond + "?" + on_true + ":" + str;
+}
+
+void Stringifier::visit(const LetNode& node) {
+	auto let = std::string("let ");
+	for (std::size_t i = 0; i < node.bindings.size(); ++i) {
+		node.bindings[i].value->accept(*this);
+		let += node.bindings[i].id + " = " + str;
+		if (i != node.bindings.size() - 1) {
+			let += "; ";
+		}
+	}
+	node.body->accept(*this);
+	str = let + " in " + str;
+}
+
+void Stringifier::visit(const GroupNode& node) {
 	node.base->accept(*this);
 	str = "(" + str + ")";
 }
 
-void Stringifier::visit(FuncNode& node) {
+void Stringifier::visit(const FuncNode& node) {
 	auto func = node.id + "(";
 	for (std::size_t i = 0; i < node.args.size(); ++i) {
 		node.args[i]->accept(*this);
@@ -39,11 +70,11 @@ void Stringifier::visit(FuncNode& node) {
 	str = func + ")";
 }
 
-void Stringifier::visit(VarNode& node) {
+void Stringifier::visit(const VarNode& node) {
 	str = node.id;
 }
 
-void Stringifier::visit(NumNode& node) {
+void Stringifier::visit(const NumNode& node) {
 	str = std::to_string(node.value);
 }
 
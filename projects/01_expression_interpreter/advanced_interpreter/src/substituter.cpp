@@ -0,0 +1,33 @@
+#include "passes.hpp"
+
+#include "ast.hpp"
+
+#include <vector>
+#include <memory>
+
+void Substituter::substitute(Node& node) {
+	rewrite(node);
+}
+
+// grouped like an inlined call, so the printed expression parses back to the same tree
+void Substituter::visit(const VarNode& node) {
+	if (node.slot || node.id != id) {
+		return;
+	}
+	replacement = Relocator(0, depth).relocate(value);
+	if (!dynamic_cast<const VarNode*>(value.get()) && !dynamic_cast<const NumNode*>(value.get()) && !dynamic_cast<const GroupNode*>(value.get())) {
+		replacement = std::make_shared<GroupNode>(std::move(replacement));
+	}
+}
+
+// a linked definition reads the variable from its own body, so that body is substituted too
+void Substituter::visit(const FuncNode& node) {
+	auto args = node.args;
+	for (auto& arg : args) {
+		rewrite(arg);
+	}
+	auto definition = node.definition ? relink(node.definition) : nullptr;
+	if (args != node.args || definition != node.definition) {
+		replacement = std::make_shared<FuncNode>(node.id, std::move(args), std::move(definition));
+	}
+}
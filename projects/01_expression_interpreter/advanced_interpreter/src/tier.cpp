@@ -0,0 +1,164 @@
+#include "tier.hpp"
+
+#include "ast.hpp"
+#include "program.hpp"
+#include "metrics.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <tuple>
+#include <complex>
+
+namespace {
+
+// a thread counts one tree walk in every sample, as sample walks of whichever expression it is evaluating then
+constexpr std::uint64_t sample = 8;
+thread_local std::uint64_t walks = 0;
+
+// the functions passed to the evaluation running on this thread, where the forwarders of a promoted Program look
+template <typename T>
+thread_local const Functions<T>* caller = nullptr;
+
+template <typename T>
+struct Scratch {
+	std::optional<Context<T>> context;
+	std::vector<T> row;
+	bool busy = false;
+};
+
+template <typename T>
+Scratch<T>& scratch() {
+	thread_local Scratch<T> buffers;
+	return buffers;
+}
+
+// hands the buffers back even when a user function throws
+template <typename T>
+struct Borrowed {
+	Scratch<T>& buffers;
+	const Functions<T>* previous;
+
+	~Borrowed() {
+		buffers.busy = false;
+		caller<T> = previous;
+	}
+};
+
+}
+
+template <typename T>
+std::optional<T> Tiers::run(const Node& root, const Variables<T>& vars, const Functions<T>& funcs, Accuracy accuracy) {
+
+	auto& state = std::get<State<T>>(states);
+	auto program = state.program.load(std::memory_order_acquire);
+	if (!program) {
+		// compiling, failed or never to be compiled: nothing left to count
+		if (state.tier.load(std::memory_order_relaxed) != Tier::tree || policy.threshold == Tiering::never) {
+			return std::nullopt;
+		}
+		if (state.interpreted.load(std::memory_order_relaxed) < policy.threshold) {
+			if (++walks % sample == 0) {
+				state.interpreted.fetch_add(sample, std::memory_order_relaxed);
+			}
+			return std::nullopt;
+		}
+		auto expected = Tier::tree;
+		if (!state.tier.compare_exchange_strong(expected, Tier::compiling)) {
+			return std::nullopt;
+		}
+		std::vector<std::string> names;
+		for (auto& [id, func] : funcs) {
+			names.emplace_back(id);
+		}
+		if (policy.background) {
+			state.compiler = std::thread([this, root, names = std::move(names), accuracy]() mutable {
+				promote<T>(root, std::move(names), accuracy);
+			});
+			return std::nullopt;
+		}
+		promote<T>(root, std::move(names), accuracy);
+		program = state.program.load(std::memory_order_acquire);
+		if (!program) {
+			return std::nullopt;
+		}
+	}
+
+	// a user function may evaluate another expression on this thread, which then gets buffers of its own
+	Scratch<T> fresh;
+	auto& buffers = scratch<T>().busy ? fresh : scratch<T>();
+	buffers.row.clear();
+	for (auto& name : program->variables()) {
+		auto it = vars.find(name);
+		if (it == vars.end()) {
+			return std::nullopt;
+		}
+		buffers.row.push_back(it->second);
+	}
+	if (buffers.context) {
+		buffers.context->reserve(*program);
+	} else {
+		buffers.context.emplace(*program);
+	}
+
+	buffers.busy = true;
+	Borrowed<T> borrowed{buffers, std::exchange(caller<T>, &funcs)};
+	return program->run(*buffers.context, buffers.row);
+}
+
+// the last copy of the expression is gone, so no evaluation can start another compiler
+Tiers::~Tiers() {
+	std::apply([](auto&... state) {
+		(..., (state.compiler.joinable() ? state.compiler.join() : void()));
+	}, states);
+}
+
+template <typename T>
+TierStats Tiers::stats() const noexcept {
+	auto& state = std::get<State<T>>(states);
+	return {state.tier.load(std::memory_order_acquire), state.interpreted.load(std::memory_order_relaxed)};
+}
+
+template <typename T>
+void Tiers::promote(const Node& root, std::vector<std::string> names, Accuracy accuracy) {
+
+	auto& state = std::get<State<T>>(states);
+
+	Stopwatch watch;
+	Functions<T> forwarders;
+	for (auto& name : names) {
+		forwarders.emplace(name, [name](const std::vector<T>& args) {
+			auto it = caller<T>->find(name);
+			if (it == caller<T>->end()) {
+				throw std::runtime_error("Function not found");
+			}
+			return it->second(args);
+		});
+	}
+	auto program = Compiler<T>(forwarders, accuracy).compile(*root);
+	Metrics::record(Phase::bind, watch.elapsed());
+
+	// a function the promoting call did not pass, or an operator T lacks, keeps the expression on the tree for good
+	if (!program) {
+		state.tier.store(Tier::failed, std::memory_order_release);
+		return;
+	}
+	state.owned = std::make_unique<const Program<T>>(std::move(*program));
+	state.program.store(state.owned.get(), std::memory_order_release);
+	state.tier.store(Tier::compiled, std::memory_order_release);
+	Metrics::count(Metric::promotions);
+}
+
+template std::optional<float> Tiers::run(const Node&, const Variables<float>&, const Functions<float>&, Accuracy);
+template std::optional<double> Tiers::run(const Node&, const Variables<double>&, const Functions<double>&, Accuracy);
+template std::optional<std::complex<double>> Tiers::run(const Node&, const Variables<std::complex<double>>&,
+	const Functions<std::complex<double>>&, Accuracy);
+
+template TierStats Tiers::stats<float>() const noexcept;
+template TierStats Tiers::stats<double>() const noexcept;
+template TierStats Tiers::stats<std::complex<double>>() const noexcept;
@@ -0,0 +1,223 @@
+#include "expression.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "arena.hpp"
+#include "ast.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <cstdio>
+
+// Expression::eval switches on the NodeKind tag; here the same parsed tree is mirrored as a class hierarchy with a
+// virtual eval that does the same lookups per node, so what separates the two columns is the dispatch alone
+namespace {
+
+using Vars = std::unordered_map<std::string, double>;
+using Funcs = std::unordered_map<std::string, std::function<double(const std::vector<double>&)>>;
+
+const std::unordered_map<std::string, double> constants = {
+	{"e", std::numbers::e},
+	{"pi", std::numbers::pi}
+};
+
+const std::unordered_map<std::string, std::function<double(double)>> unary_ops = {
+	{"+", [](double x) { return x; }},
+	{"-", [](double x) { return -x; }}
+};
+
+const std::unordered_map<std::string, std::function<double(double, double)>> binary_ops = {
+	{"+", [](double x, double y) { return x + y; }},
+	{"-", [](double x, double y) { return x - y; }},
+	{"*", [](double x, double y) { return x * y; }},
+	{"/", [](double x, double y) { return x / y; }},
+	{"^", [](double x, double y) { return std::pow(x, y); }},
+};
+
+double unary(const std::vector<double>& args, double (*f)(double)) {
+	if (args.size() != 1) {
+		throw std::invalid_argument("Invalid number of arguments");
+	}
+	return f(args[0]);
+}
+
+const Funcs builtin_funcs = {
+	{"sin", [](const std::vector<double>& args) { return unary(args, [](double x) { return std::sin(x); }); }},
+	{"cos", [](const std::vector<double>& args) { return unary(args, [](double x) { return std::cos(x); }); }},
+	{"log", [](const std::vector<double>& args) { return unary(args, [](double x) { return std::log(x); }); }},
+	{"exp", [](const std::vector<double>& args) { return unary(args, [](double x) { return std::exp(x); }); }},
+};
+
+struct Virtual {
+	virtual ~Virtual() noexcept = default;
+	virtual double eval(const Vars&, const Funcs&) const = 0;
+};
+
+struct Binary : Virtual {
+	std::string op;
+	std::unique_ptr<Virtual> left, right;
+
+	Binary(const std::string& op, std::unique_ptr<Virtual> left, std::unique_ptr<Virtual> right)
+		: op(op), left(std::move(left)), right(std::move(right)) {}
+
+	double eval(const Vars& vars, const Funcs& funcs) const override {
+		auto l = left->eval(vars, funcs);
+		auto r = right->eval(vars, funcs);
+		return binary_ops.at(op)(l, r);
+	}
+};
+
+struct Unary : Virtual {
+	std::string op;
+	std::unique_ptr<Virtual> base;
+
+	Unary(const std::string& op, std::unique_ptr<Virtual> base) : op(op), base(std::move(base)) {}
+
+	double eval(const Vars& vars, const Funcs& funcs) const override {
+		return unary_ops.at(op)(base->eval(vars, funcs));
+	}
+};
+
+struct Group : Virtual {
+	std::unique_ptr<Virtual> base;
+
+	Group(std::unique_ptr<Virtual> base) : base(std::move(base)) {}
+
+	double eval(const Vars& vars, const Funcs& funcs) const override {
+		return base->eval(vars, funcs);
+	}
+};
+
+struct Func : Virtual {
+	std::string id;
+	std::vector<std::unique_ptr<Virtual>> args;
+
+	double eval(const Vars& vars, const Funcs& funcs) const override {
+		std::vector<double> values;
+		values.reserve(args.size());
+		for (auto& arg : args) {
+			values.push_back(arg->eval(vars, funcs));
+		}
+		if (auto it = builtin_funcs.find(id); it != builtin_funcs.end()) {
+			return it->second(values);
+		}
+		if (auto it = funcs.find(id); it != funcs.end()) {
+			return it->second(values);
+		}
+		throw std::runtime_error("Undefined func id");
+	}
+};
+
+struct Var : Virtual {
+	std::string id;
+
+	Var(const std::string& id) : id(id) {}
+
+	double eval(const Vars& vars, const Funcs&) const override {
+		if (auto it = constants.find(id); it != constants.end()) {
+			return it->second;
+		}
+		if (auto it = vars.find(id); it != vars.end()) {
+			return it->second;
+		}
+		throw std::runtime_error("Undefined var id");
+	}
+};
+
+struct Num : Virtual {
+	double value;
+
+	Num(double value) : value(value) {}
+
+	double eval(const Vars&, const Funcs&) const override {
+		return value;
+	}
+};
+
+std::unique_ptr<Virtual> mirror(ASTNode *root) {
+	switch (root->kind) {
+		case NodeKind::BINARY: {
+			auto node = static_cast<BinaryNode*>(root);
+			return std::make_unique<Binary>(node->op, mirror(node->left), mirror(node->right));
+		}
+		case NodeKind::UNARY: {
+			auto node = static_cast<UnaryNode*>(root);
+			return std::make_unique<Unary>(node->op, mirror(node->base));
+		}
+		case NodeKind::GROUP: {
+			return std::make_unique<Group>(mirror(static_cast<GroupNode*>(root)->base));
+		}
+		case NodeKind::FUNC: {
+			auto node = static_cast<FuncNode*>(root);
+			auto func = std::make_unique<Func>();
+			func->id = node->id;
+			for (auto arg : node->args) {
+				func->args.push_back(mirror(arg));
+			}
+			return func;
+		}
+		case NodeKind::VAR: {
+			return std::make_unique<Var>(static_cast<VarNode*>(root)->id);
+		}
+		case NodeKind::NUM: {
+			return std::make_unique<Num>(static_cast<NumNode*>(root)->value);
+		}
+	}
+	throw std::runtime_error("Unknown node kind");
+}
+
+// best of five runs over the same inputs, in ns per evaluation; the sum keeps the calls from being discarded
+template <typename F>
+double nanoseconds(F eval, std::size_t n) {
+	volatile double sink = 0;
+	double best = INFINITY;
+	for (int round = 0; round < 5; ++round) {
+		auto start = std::chrono::steady_clock::now();
+		double sum = 0;
+		for (std::size_t i = 0; i < n; ++i) {
+			sum += eval(static_cast<double>(i) * 1e-3);
+		}
+		sink = sink + sum;
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n);
+	}
+	return best;
+}
+
+}
+
+int main() {
+	const std::vector<std::string> inputs = {
+		"2+3*4",
+		"x*x*x - 2*x + 1",
+		"sin(x) * exp(-x / 4) + f(x, y) - 2^-y",
+		"((x + 1) * (x - 1) + (y + 2) * (y - 2)) / (x*x + y*y + 1) - cos(pi * x) * log(1 + y*y)",
+	};
+	Funcs funcs = {{"f", [](const std::vector<double>& args) { return args[0] * args[1]; }}};
+
+	std::printf("%-40s %12s %12s %8s\n", "", "switch ns", "virtual ns", "ratio");
+	for (auto& input : inputs) {
+		Expression expression(input);
+		Lexer lexer(input);
+		const auto& tokens = lexer.tokenize();
+		Arena arena;
+		auto tree = mirror(Parser(tokens, arena).parse());
+
+		Vars vars = {{"x", 0.}, {"y", 0.5}};
+		auto& x = vars.at("x");
+		if (expression.eval(vars, funcs) != tree->eval(vars, funcs)) {
+			std::printf("%s: the two trees disagree\n", input.c_str());
+			return 1;
+		}
+		auto tagged = nanoseconds([&](double value) { x = value; return expression.eval(vars, funcs); }, 200000);
+		auto virtuals = nanoseconds([&](double value) { x = value; return tree->eval(vars, funcs); }, 200000);
+		auto name = input.size() > 40 ? input.substr(0, 37) + "..." : input;
+		std::printf("%-40s %12.1f %12.1f %8.2f\n", name.c_str(), tagged, virtuals, virtuals / tagged);
+	}
+}
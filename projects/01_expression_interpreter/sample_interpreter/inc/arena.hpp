@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ast.hpp"
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <new>
+#include <cstddef>
+
+class Arena {
+public:
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena(Arena&&) noexcept;
+	~Arena();
+
+	Arena& operator=(const Arena&) = delete;
+	Arena& operator=(Arena&&) noexcept;
+
+	template <typename Node, typename... Args>
+	Node *make(Args&&... args) {
+		nodes.reserve(nodes.size() + 1);
+		auto node = new (allocate(sizeof(Node), alignof(Node))) Node(std::forward<Args>(args)...);
+		nodes.push_back(node);
+		return node;
+	}
+private:
+	std::vector<std::unique_ptr<std::byte[]>> blocks;
+	std::vector<ASTNode*> nodes;
+	std::size_t used = 0, capacity = 0;
+
+	void *allocate(std::size_t, std::size_t);
+	void clear() noexcept;
+
+	static const std::size_t block_size;
+};
\ No newline at end of file
@@ -3,7 +3,14 @@
 #include <string>
 #include <vector>
 
+enum class NodeKind {
+	BINARY, UNARY, GROUP, FUNC, VAR, NUM
+};
+
 struct ASTNode {
+	const NodeKind kind;
+
+	ASTNode(NodeKind kind) : kind(kind) {}
 	virtual ~ASTNode() noexcept = default;
 };
 
@@ -11,37 +18,37 @@ struct BinaryNode : ASTNode {
 	std::string op;
 	ASTNode *left, *right;
 
-	BinaryNode(const std::string& op, ASTNode *left, ASTNode *right) : op(op), left(left), right(right) {}
+	BinaryNode(const std::string& op, ASTNode *left, ASTNode *right) : ASTNode(NodeKind::BINARY), op(op), left(left), right(right) {}
 };
 
 struct UnaryNode : ASTNode {
 	std::string op;
 	ASTNode *base;
 
-	UnaryNode(const std::string& op, ASTNode *base) : op(op), base(base) {}
+	UnaryNode(const std::string& op, ASTNode *base) : ASTNode(NodeKind::UNARY), op(op), base(base) {}
 };
 
 struct GroupNode : ASTNode {
 	ASTNode *base;
 
-	GroupNode(ASTNode *base) : base(base) {}
+	GroupNode(ASTNode *base) : ASTNode(NodeKind::GROUP), base(base) {}
 };
 
 struct FuncNode : ASTNode {
 	std::string id;
 	std::vector<ASTNode*> args;
 
-	FuncNode(const std::string& id, const std::vector<ASTNode*>& args) : id(id), args(args) {}
+	FuncNode(const std::string& id, const std::vector<ASTNode*>& args) : ASTNode(NodeKind::FUNC), id(id), args(args) {}
 };
 
 struct VarNode : ASTNode {
 	std::string id;
 
-	VarNode(const std::string& id) : id(id) {}
+	VarNode(const std::string& id) : ASTNode(NodeKind::VAR), id(id) {}
 };
 
 struct NumNode : ASTNode {
 	double value;
 
-	NumNode(const std::string& value) : value(std::stod(value)) {}
+	NumNode(const std::string& value) : ASTNode(NodeKind::NUM), value(std::stod(value)) {}
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ast.hpp"
+#include "arena.hpp"
 
 #include <string>
 #include <unordered_map>
@@ -15,6 +16,7 @@ public:
 				const std::unordered_map<std::string, std::function<double(const std::vector<double>&)>>&) const;
 private:
 	std::string input;
+	Arena arena;
 	ASTNode *root;
 
 	std::string to_string_helper(ASTNode *) const noexcept;
@@ -2,17 +2,19 @@
 
 #include "token.hpp"
 #include "ast.hpp"
+#include "arena.hpp"
 
 #include <string>
 #include <vector>
 
 class Parser {
 public:
-	Parser(const std::vector<Token>&);
+	Parser(const std::vector<Token>&, Arena&);
 	ASTNode *parse();
 private:
 	std::vector<Token> tokens;
 	std::size_t index = 0;
+	Arena& arena;
 
 	ASTNode *parse_sum();
 	ASTNode *parse_mul();
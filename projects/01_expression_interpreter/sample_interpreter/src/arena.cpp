@@ -0,0 +1,50 @@
+#include "arena.hpp"
+
+#include "ast.hpp"
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+Arena::Arena(Arena&& other) noexcept
+	: blocks(std::move(other.blocks)), nodes(std::move(other.nodes)),
+	  used(std::exchange(other.used, 0)), capacity(std::exchange(other.capacity, 0)) {}
+
+Arena::~Arena() {
+	clear();
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+	if (this != &other) {
+		clear();
+		blocks = std::move(other.blocks);
+		nodes = std::move(other.nodes);
+		used = std::exchange(other.used, 0);
+		capacity = std::exchange(other.capacity, 0);
+	}
+	return *this;
+}
+
+void *Arena::allocate(std::size_t size, std::size_t alignment) {
+	auto offset = (used + alignment - 1) / alignment * alignment;
+	if (blocks.empty() || offset + size > capacity) {
+		capacity = std::max(block_size, size + alignment);
+		blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(capacity));
+		offset = 0;
+	}
+	used = offset + size;
+	return blocks.back().get() + offset;
+}
+
+void Arena::clear() noexcept {
+	for (auto node = nodes.rbegin(); node != nodes.rend(); ++node) {
+		(*node)->~ASTNode();
+	}
+	nodes.clear();
+	blocks.clear();
+	used = capacity = 0;
+}
+
+const std::size_t Arena::block_size = 4096;
\ No newline at end of file
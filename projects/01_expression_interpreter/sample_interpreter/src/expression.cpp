@@ -5,6 +5,7 @@
 
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "arena.hpp"
 
 #include <string>
 #include <vector>
@@ -18,7 +19,7 @@
 Expression::Expression(const std::string& input) : input(input) {
 	Lexer lexer(input);
 	const auto& tokens = lexer.tokenize();
-	Parser parser(tokens);
+	Parser parser(tokens, arena);
 	root = parser.parse();
 }
 
@@ -32,86 +33,107 @@ double Expression::eval(const std::unordered_map<std::string, double>& vars,
 }
 
 std::string Expression::to_string_helper(ASTNode *root) const noexcept {
-	if (auto node = dynamic_cast<BinaryNode*>(root); node) {
-		return to_string_helper(node->left) + node->op + to_string_helper(node->right);
-	}
+	switch (root->kind) {
+		case NodeKind::BINARY: {
+			auto node = static_cast<BinaryNode*>(root);
+			return to_string_helper(node->left) + node->op + to_string_helper(node->right);
+		}
 
-	if (auto node = dynamic_cast<UnaryNode*>(root); node) {
-		return node->op + to_string_helper(node->base);
-	}
+		case NodeKind::UNARY: {
+			auto node = static_cast<UnaryNode*>(root);
+			return node->op + to_string_helper(node->base);
+		}
 
-	if (auto node = dynamic_cast<GroupNode*>(root); node) {
-		return "(" + to_string_helper(node->base) + ")";
-	}
+		case NodeKind::GROUP: {
+			auto node = static_cast<GroupNode*>(root);
+			return "(" + to_string_helper(node->base) + ")";
+		}
 
-	if (auto node = dynamic_cast<FuncNode*>(root); node) {
-		auto func = node->id + "(";
-		for (std::size_t i = 0; i < node->args.size(); ++i) {
-			func += to_string_helper(node->args[i]);
-			if (i < node->args.size() - 1) {
-				func += ", ";
+		case NodeKind::FUNC: {
+			auto node = static_cast<FuncNode*>(root);
+			auto func = node->id + "(";
+			for (std::size_t i = 0; i < node->args.size(); ++i) {
+				func += to_string_helper(node->args[i]);
+				if (i < node->args.size() - 1) {
+					func += ", ";
+				}
 			}
+			return func + ")";
 		}
-		return func + ")";
-	}
 
-	if (auto node = dynamic_cast<VarNode*>(root); node) {
-		return node->id;
-	}
+		case NodeKind::VAR: {
+			auto node = static_cast<VarNode*>(root);
+			return node->id;
+		}
 
-	auto node = dynamic_cast<NumNode*>(root);
-	return std::to_string(node->value);
+		case NodeKind::NUM: {
+			auto node = static_cast<NumNode*>(root);
+			return std::to_string(node->value);
+		}
+	}
+	return "";
 }
 
 double Expression::eval_helper(ASTNode *root, const std::unordered_map<std::string, double>& vars,
 								const std::unordered_map<std::string, std::function<double(const std::vector<double>&)>>& funcs) const {
 
-	if (auto node = dynamic_cast<BinaryNode*>(root); node) {
-		auto left = eval_helper(node->left, vars, funcs);
-		auto right = eval_helper(node->right, vars, funcs);
-		return binary_ops.at(node->op)(left, right);
-	}
-
-	if (auto node = dynamic_cast<UnaryNode*>(root); node) {
-		auto base = eval_helper(node->base, vars, funcs);
-		return unary_ops.at(node->op)(base);
-	}
-
-	if (auto node = dynamic_cast<GroupNode*>(root); node) {
-		return eval_helper(node->base, vars, funcs);
-	}
-
-	if (auto node = dynamic_cast<FuncNode*>(root); node) {
-		std::vector<double> args;
-		for (auto arg : node->args) {
-			args.push_back(eval_helper(arg, vars, funcs));
+	switch (root->kind) {
+		case NodeKind::BINARY: {
+			auto node = static_cast<BinaryNode*>(root);
+			auto left = eval_helper(node->left, vars, funcs);
+			auto right = eval_helper(node->right, vars, funcs);
+			return binary_ops.at(node->op)(left, right);
 		}
 
-		if (builtin_funcs.contains(node->id)) {
-			return builtin_funcs.at(node->id)(args);
+		case NodeKind::UNARY: {
+			auto node = static_cast<UnaryNode*>(root);
+			auto base = eval_helper(node->base, vars, funcs);
+			return unary_ops.at(node->op)(base);
 		}
 
-		if (funcs.contains(node->id)) {
-			return funcs.at(node->id)(args);
+		case NodeKind::GROUP: {
+			auto node = static_cast<GroupNode*>(root);
+			return eval_helper(node->base, vars, funcs);
 		}
 
-		throw std::runtime_error("Undefined func id");
-	}
+		case NodeKind::FUNC: {
+			auto node = static_cast<FuncNode*>(root);
+			std::vector<double> args;
+			args.reserve(node->args.size());
+			for (auto arg : node->args) {
+				args.push_back(eval_helper(arg, vars, funcs));
+			}
+
+			if (auto it = builtin_funcs.find(node->id); it != builtin_funcs.end()) {
+				return it->second(args);
+			}
+
+			if (auto it = funcs.find(node->id); it != funcs.end()) {
+				return it->second(args);
+			}
 
-	if (auto node = dynamic_cast<VarNode*>(root); node) {
-		if (constants.contains(node->id)) {
-			return constants.at(node->id);
+			throw std::runtime_error("Undefined func id");
 		}
 
-		if (vars.contains(node->id)) {
-			return vars.at(node->id);
+		case NodeKind::VAR: {
+			auto node = static_cast<VarNode*>(root);
+			if (auto it = constants.find(node->id); it != constants.end()) {
+				return it->second;
+			}
+
+			if (auto it = vars.find(node->id); it != vars.end()) {
+				return it->second;
+			}
+
+			throw std::runtime_error("Undefined var id");
 		}
 
-		throw std::runtime_error("Undefined var id");
+		case NodeKind::NUM: {
+			auto node = static_cast<NumNode*>(root);
+			return node->value;
+		}
 	}
-
-	auto node = dynamic_cast<NumNode*>(root);
-	return node->value;
+	throw std::runtime_error("Unknown node kind");
 }
 
 const std::unordered_map<std::string, double> Expression::constants = {
@@ -1,9 +1,14 @@
 #include "expression.hpp"
 
 #include <iostream>
+#include <vector>
 
 int main() {
 	std::string input = "2+3*4";
 	Expression expr(input);
-	std::cout << expr.to_string() << std::endl;
-}
\ No newline at end of file
+	std::cout << expr.to_string() << " = " << expr.eval({}, {}) << std::endl;
+
+	Expression wave("sin(x) * exp(-x / 4) + f(x, y) - 2^-y");
+	auto f = [](const std::vector<double>& args) { return args[0] * args[1]; };
+	std::cout << wave.to_string() << " = " << wave.eval({{"x", 1.5}, {"y", 2.}}, {{"f", f}}) << std::endl;
+}
@@ -2,13 +2,14 @@
 
 #include "token.hpp"
 #include "ast.hpp"
+#include "arena.hpp"
 
 #include <string>
 #include <vector>
 
 #include <stdexcept>
 
-Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens) {}
+Parser::Parser(const std::vector<Token>& tokens, Arena& arena) : tokens(tokens), arena(arena) {}
 
 ASTNode *Parser::parse() {
 	return parse_sum();
@@ -19,7 +20,7 @@ ASTNode *Parser::parse_sum() {
 	while (match(TokenType::PLUS) || match(TokenType::MINUS)) {
 		const auto& op = prev().value;
 		auto right = parse_mul();
-		left = new BinaryNode(op, left, right);
+		left = arena.make<BinaryNode>(op, left, right);
 	}
 	return left;
 }
@@ -29,7 +30,7 @@ ASTNode *Parser::parse_mul() {
 	while (match(TokenType::STAR) || match(TokenType::SLASH)) {
 		const auto& op = prev().value;
 		auto right = parse_pow();
-		left = new BinaryNode(op, left, right);
+		left = arena.make<BinaryNode>(op, left, right);
 	}
 	return left;
 }
@@ -39,7 +40,7 @@ ASTNode *Parser::parse_pow() {
 	if (match(TokenType::CARET)) {
 		const auto& op = prev().value;
 		auto right = parse_pow();
-		left = new BinaryNode(op, left, right);
+		left = arena.make<BinaryNode>(op, left, right);
 	}
 	return left;
 }
@@ -48,7 +49,7 @@ ASTNode *Parser::parse_unary() {
 	if (match(TokenType::PLUS) || match(TokenType::MINUS)) {
 		const auto& op = prev().value;
 		auto base = parse_unary();
-		return new UnaryNode(op, base);
+		return arena.make<UnaryNode>(op, base);
 	}
 	return parse_primary();
 }
@@ -56,7 +57,7 @@ ASTNode *Parser::parse_unary() {
 ASTNode *Parser::parse_primary() {
 	if (match(TokenType::NUM)) {
 		const auto& num = prev().value;
-		return new NumNode(num);
+		return arena.make<NumNode>(num);
 	}
 
 	if (match(TokenType::LPAREN)) {
@@ -73,7 +74,7 @@ ASTNode *Parser::parse_primary() {
 ASTNode *Parser::parse_group() {
 	auto base = parse();
 	consume(TokenType::RPAREN, "Expected ), got " + current().value);
-	return new GroupNode(base);
+	return arena.make<GroupNode>(base);
 }
 
 ASTNode *Parser::parse_func() {
@@ -85,13 +86,13 @@ ASTNode *Parser::parse_func() {
 			do {
 				auto arg = parse();
 				args.push_back(arg);
-			} while (!match(TokenType::COMMA));
+			} while (match(TokenType::COMMA));
 		}
 		consume(TokenType::RPAREN, "Expected ), got " + current().value);
-		return new FuncNode(id, args);
+		return arena.make<FuncNode>(id, args);
 	}
 
-	return new VarNode(id);
+	return arena.make<VarNode>(id);
 }
 
 inline Token Parser::current() const noexcept {